@@ -2,6 +2,14 @@ let timestamps = [];
 let temperatures = [];
 let temperatureChart;
 
+const chartPoints = 300;
+const tableLimit = 1000;
+const chartWindows = {
+    'Raw Data': 24 * 3600 * 1000,
+    'Hourly Averages': 30 * 24 * 3600 * 1000,
+    'Daily Averages': 360 * 24 * 3600 * 1000
+};
+
 function downsampleData(timestamps, temperatures, maxPoints = 300) {
     if (timestamps.length <= maxPoints) {
         return { timestamps, temperatures };
@@ -59,7 +67,7 @@ function downsampleData(timestamps, temperatures, maxPoints = 300) {
 
 function createChart() {
     const ctx = document.getElementById('temperatureChart').getContext('2d');
-    let chartData = downsampleData([...timestamps].reverse(), [...temperatures].reverse());
+    let chartData = downsampleData(timestamps, temperatures);
     
     temperatureChart = new Chart(ctx, {
         type: 'line',
@@ -177,9 +185,9 @@ function updateTable(readings) {
     });
 }
 
-function fetchLatestData() {
-    const currentPath = window.location.pathname;
-    const apiUrl = `${serviceEndpoint}${currentPath}`;
+function fetchChartData() {
+    const from = Date.now() - (chartWindows[chartPeriod] || chartWindows['Raw Data']);
+    const apiUrl = `${serviceEndpoint}/aggregate?from=${from}&points=${chartPoints}`;
     fetch(apiUrl, {
         headers: {
             'Accept': 'application/json'
@@ -187,27 +195,37 @@ function fetchLatestData() {
     })
     .then(response => response.json())
     .then(data => {
-        if (data.readings && data.readings.length > 0) {
-            const newTimestamps = [];
-            const newTemperatures = [];
-            
-            data.readings.forEach(reading => {
-                newTimestamps.push(reading.timestamp);
-                newTemperatures.push(reading.temperature);
-            });
-            
-            timestamps = newTimestamps;
-            temperatures = newTemperatures;
+        if (data.buckets && data.buckets.length > 0) {
+            timestamps = data.buckets.map(bucket => bucket.timestamp);
+            temperatures = data.buckets.map(bucket => bucket.avg);
             
             if (!temperatureChart) {
                 createChart();
             } else {
-                const newChartData = downsampleData([...timestamps].reverse(), [...temperatures].reverse());
+                const newChartData = downsampleData(timestamps, temperatures);
                 temperatureChart.data.labels = newChartData.timestamps;
                 temperatureChart.data.datasets[0].data = newChartData.temperatures;
                 temperatureChart.update();
             }
-            
+        }
+    })
+    .catch(error => {
+        console.error('Error fetching chart data:', error);
+    });
+}
+
+function fetchTableData() {
+    const currentPath = window.location.pathname;
+    const query = window.location.search || `?limit=${tableLimit}`;
+    const apiUrl = `${serviceEndpoint}${currentPath}${query}`;
+    fetch(apiUrl, {
+        headers: {
+            'Accept': 'application/json'
+        }
+    })
+    .then(response => response.json())
+    .then(data => {
+        if (data.readings && data.readings.length > 0) {
             updateTable(data.readings);
             
             const countInfo = document.querySelector('.count-info');
@@ -219,6 +237,11 @@ function fetchLatestData() {
     });
 }
 
+function fetchLatestData() {
+    fetchChartData();
+    fetchTableData();
+}
+
 document.addEventListener('DOMContentLoaded', function() {
     fetchLatestData();
 });
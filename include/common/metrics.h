@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace NMetrics {
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TCounter {
+public:
+    void Increment(uint64_t value = 1);
+    uint64_t Get() const;
+
+private:
+    std::atomic<uint64_t> Value_{0};
+};
+
+class TGauge {
+public:
+    void Set(int64_t value);
+    void Add(int64_t value);
+    int64_t Get() const;
+
+private:
+    std::atomic<int64_t> Value_{0};
+};
+
+//! Cumulative histogram over fixed upper bounds, the last bucket is +Inf.
+class THistogram {
+public:
+    explicit THistogram(std::vector<double> bounds);
+
+    void Record(double value);
+
+    const std::vector<double>& GetBounds() const;
+
+    //! Number of recorded values not greater than each bound, plus the total.
+    std::vector<uint64_t> GetCumulativeCounts() const;
+    uint64_t GetCount() const;
+    double GetSum() const;
+    double GetMax() const;
+
+private:
+    std::vector<double> Bounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> Counts_;
+    std::atomic<uint64_t> Count_{0};
+    std::atomic<double> Sum_{0};
+    std::atomic<double> Max_{0};
+};
+
+//! Upper bounds 1, 2, 5, 10, 20, 50, ... up to `max`.
+std::vector<double> ExponentialBounds(double max);
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Process-wide named metrics. Getters create a metric on first use and
+//! return the same instance afterwards, so callers may cache the pointers.
+class TMetricRegistry {
+public:
+    static TMetricRegistry& GetInstance();
+
+    std::shared_ptr<TCounter> GetCounter(const std::string& name);
+    std::shared_ptr<TGauge> GetGauge(const std::string& name);
+    std::shared_ptr<THistogram> GetHistogram(const std::string& name, const std::vector<double>& bounds);
+
+    //! Prometheus text exposition format.
+    std::string FormatText();
+
+private:
+    TMetricRegistry() = default;
+
+    std::map<std::string, std::shared_ptr<TCounter>> Counters_;
+    std::map<std::string, std::shared_ptr<TGauge>> Gauges_;
+    std::map<std::string, std::shared_ptr<THistogram>> Histograms_;
+    std::mutex Mutex_;
+};
+
+inline TMetricRegistry& GetMetricRegistry() {
+    return TMetricRegistry::GetInstance();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NMetrics
@@ -5,7 +5,9 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 
 namespace NCommon {
 
@@ -22,6 +24,8 @@ public:
     );
 
     void Start();
+
+    //! Wakes up a worker waiting for the next run, a run in progress finishes.
     void Stop();
 
 private:
@@ -33,6 +37,8 @@ private:
     TIntrusivePtr<TInvoker> Invoker_;
     std::chrono::milliseconds Delay_;
     std::atomic<bool> StopFlag_{false};
+    std::mutex StopMutex_;
+    std::condition_variable StopCondition_;
 };
 
 DECLARE_REFCOUNTED(TPeriodicExecutor);
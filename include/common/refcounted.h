@@ -115,6 +115,11 @@ inline bool TryRef(T* obj) {
     return TRefCountedHelper<T>::GetRefCounter(obj)->TryRef();
 }
 
+template <class T>
+inline int GetRefCount(T* obj) {
+    return TRefCountedHelper<T>::GetRefCounter(obj)->GetRefCount();
+}
+
 template <class T>
 inline void WeakRef(T* obj) {
     TRefCountedHelper<T>::GetRefCounter(obj)->WeakRef();
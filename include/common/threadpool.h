@@ -121,7 +121,7 @@ public:
 
     void ThrowOnError() const {
         if (!IsOkay_) {
-            throw std::get<TError>(Value_);
+            throw *Value_;
         }
     }
 
@@ -5,8 +5,14 @@
 #include <common/exception.h>
 #include <common/config.h>
 
+#include <ipc/db_pool.h>
+#include <ipc/db_listener.h>
+
 #include <pqxx/pqxx>
+#include <chrono>
+#include <map>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <unordered_map>
 
@@ -26,6 +32,42 @@ struct TDataBaseConfig
     std::string UserName;
     std::string Password;
 
+    //! Readings per COPY batch, one disables batching.
+    uint32_t MaxBatchSize;
+    std::chrono::milliseconds MaxBatchLatency;
+
+    //! Write pool bounds, the read-only pool shares the minimum.
+    uint32_t PoolMinSize;
+    uint32_t PoolMaxSize;
+    uint32_t ReadPoolMaxSize;
+    std::chrono::milliseconds PoolAcquireTimeout;
+    std::chrono::milliseconds PoolHealthCheckInterval;
+    std::chrono::milliseconds PoolIdleTimeout;
+
+    //! Range-partitioned tables, retention drops whole partitions.
+    bool Partitioned;
+    uint32_t PartitionsAhead;
+
+    //! Expired rows are deleted by a janitor, at most a batch per statement.
+    std::chrono::milliseconds RetentionInterval;
+    uint32_t RetentionBatchSize;
+
+    //! Raw ranges and aggregates are queried from the database, only the
+    //! newest `hot_window_ms` of raw readings are cached.
+    bool Pushdown;
+    std::chrono::milliseconds HotWindow;
+
+    //! A follower does not write, its cache follows the notifications of
+    //! the writer, which sends them with `notify_followers`.
+    bool Follower;
+    bool NotifyFollowers;
+
+    //! Readings that failed to be written go to this file and are replayed
+    //! in the background, empty disables spooling.
+    std::string SpoolPath;
+    uint32_t SpoolReplayBatchSize;
+    std::chrono::milliseconds SpoolRetryInterval;
+
     void Load(const nlohmann::json& data) override;
 };
 
@@ -33,17 +75,37 @@ DECLARE_REFCOUNTED(TDataBaseConfig);
 
 ////////////////////////////////////////////////////////////////////////////////
 
-class TTransaction;
+enum class ETransactionMode {
+    ReadWrite,
+    ReadOnly,
+    //! No BEGIN/COMMIT, every statement commits on its own. Saves two round
+    //! trips for single statements.
+    Autocommit,
+};
 
-class TDbClient : public NRefCounted::TRefCountedBase {
+//! Transaction on a connection checked out of a pool. The connection goes
+//! back to the pool once the transaction is finished and destroyed.
+class TTransaction {
 public:
-
     using TParamMap = std::unordered_map<std::string, std::string>;
     using TQueryParams = std::vector<std::string>;
 
-    TDbClient(TDataBaseConfigPtr config);
-    
-    void Connect();
+    TTransaction(TPooledConnection connection, ETransactionMode mode);
+    ~TTransaction();
+
+    TTransaction(TTransaction&& other) noexcept = default;
+
+    //! Executes a statement registered in the pool, arguments are sent as
+    //! typed parameters $1, $2, ...
+    template <typename... Args>
+    pqxx::result ExecutePrepared(const std::string& name, Args&&... args) {
+        try {
+            return GetTxn().exec(pqxx::prepped{name}, pqxx::params(std::forward<Args>(args)...));
+        } catch (const std::exception& ex) {
+            LOG_ERROR("Prepared statement '{}' failed: {}", name, ex.what());
+            throw;
+        }
+    }
 
     template <typename Container>
     requires (std::is_same_v<typename Container::value_type, std::string>)
@@ -60,19 +122,40 @@ public:
         return ExecuteQuery(query, pqxx::params(std::forward<Args>(args)...));
     }
 
-    inline pqxx::result ExecuteQuery(const std::string& query, pqxx::params&& params) {
+    pqxx::result ExecuteQuery(const std::string& query, pqxx::params&& params);
+
+    //! Streams rows into `table` with COPY.
+    template <typename... Types>
+    void CopyRows(const std::string& table, const std::vector<std::string>& columns, const std::vector<std::tuple<Types...>>& rows) {
         try {
-            auto guard = std::lock_guard(Mutex_);
-            if (Txn_) {
-                return Txn_->exec(query, params);
-            } else {
-                pqxx::work txn(*Conn_);
-                auto res = txn.exec(query, params);
-                txn.commit();
-                return res;
+            auto& txn = GetTxn();
+
+            std::vector<std::string> quoted;
+            for (const auto& column : columns) {
+                quoted.push_back(txn.quote_name(column));
             }
+
+            auto stream = pqxx::stream_to::raw_table(txn, txn.quote_name(table), NCommon::Join(quoted, ", "));
+            for (const auto& row : rows) {
+                std::apply([&] (const auto&... values) { stream.write_values(values...); }, row);
+            }
+            stream.complete();
         } catch (const std::exception& ex) {
-            LOG_ERROR("Parameterized query failed: {}", ex.what());
+            LOG_ERROR("COPY into {} failed: {}", table, ex.what());
+            throw;
+        }
+    }
+
+    //! Streams the rows of `query` with COPY TO STDOUT instead of building a
+    //! result set, `consumer` gets the columns of every row as `Types...`.
+    template <typename... Types, typename Consumer>
+    void StreamRows(const std::string& query, Consumer&& consumer) {
+        try {
+            for (const auto& row : GetTxn().stream<Types...>(query)) {
+                std::apply(consumer, row);
+            }
+        } catch (const std::exception& ex) {
+            LOG_ERROR("Streaming query failed: {}", ex.what());
             throw;
         }
     }
@@ -80,50 +163,97 @@ public:
     void InsertRow(const std::string& table, const TParamMap& columns);
     void DeleteRow(const std::string& table, const std::string& conditions = "");
 
-    pqxx::result SelectRows(const std::string& table, 
+    pqxx::result SelectRows(const std::string& table,
                            const std::string& conditions = "",
                            const TQueryParams& orderBy = {},
                            int limit = -1);
 
-    TTransaction BeginTransaction();
-    TTransaction BeginTransactionWithTimeout(std::chrono::milliseconds timeout);
-
     void Commit();
     void Rollback();
 
 private:
-    std::unique_ptr<pqxx::connection> Conn_;
-    std::shared_ptr<pqxx::transaction<>> Txn_;
-    std::mutex Mutex_;
-    TDataBaseConfigPtr Config_;
+    pqxx::transaction_base& GetTxn();
 
-    friend TTransaction;
+    // Declared first so the transaction is closed before the connection is released.
+    TPooledConnection Connection_;
+    std::unique_ptr<pqxx::transaction_base> Txn_;
 
     inline static const std::string LoggingSource = "Client";
 };
 
-DECLARE_REFCOUNTED(TDbClient);
-
 ////////////////////////////////////////////////////////////////////////////////
 
-class TTransaction {
+//! Writes go through a pool of read-write connections, reads through a
+//! separate read-only pool, so long reads do not wait behind ingestion.
+class TDbClient : public NRefCounted::TRefCountedBase {
 public:
-    using TParamMap = std::unordered_map<std::string, std::string>;
-    using TQueryParams = std::vector<std::string>;
 
-    TTransaction(TDbClientPtr client, std::shared_ptr<pqxx::transaction<>> Txn);
-    ~TTransaction();
+    using TParamMap = TTransaction::TParamMap;
+    using TQueryParams = TTransaction::TQueryParams;
 
-    void Commit();
-    void Rollback();
+    TDbClient(TDataBaseConfigPtr config);
+    
+    //! Opens the minimal number of connections in both pools.
+    void Connect();
+
+    //! Registers a named prepared statement in the write pool. It is prepared
+    //! on one connection right away and on every other one on checkout.
+    void RegisterStatement(const std::string& name, const std::string& query);
+
+    //! Executes a single registered statement in autocommit mode.
+    template <typename... Args>
+    pqxx::result ExecutePrepared(const std::string& name, Args&&... args) {
+        auto txn = BeginAutocommit();
+        auto res = txn.ExecutePrepared(name, std::forward<Args>(args)...);
+        txn.Commit();
+        return res;
+    }
+
+    template <typename... Args>
+    inline pqxx::result ExecuteQuery(const std::string& query, Args&&... args) {
+        auto txn = BeginAutocommit();
+        auto res = txn.ExecuteQuery(query, std::forward<Args>(args)...);
+        txn.Commit();
+        return res;
+    }
+
+    void InsertRow(const std::string& table, const TParamMap& columns);
+    void DeleteRow(const std::string& table, const std::string& conditions = "");
+
+    //! Served by the read-only pool.
+    pqxx::result SelectRows(const std::string& table, 
+                           const std::string& conditions = "",
+                           const TQueryParams& orderBy = {},
+                           int limit = -1);
+
+    //! Checks out a connection from the write pool, blocks while the pool
+    //! is exhausted and throws after `pool_acquire_timeout_ms`.
+    TTransaction BeginTransaction();
+
+    //! Checks out a connection from the read-only pool.
+    TTransaction BeginReadTransaction();
+
+    //! Checks out a connection from the write pool without opening a transaction.
+    TTransaction BeginAutocommit();
+
+    //! Listener on its own connection, not started yet.
+    TDbListenerPtr CreateListener(
+        const std::string& channel,
+        TDbListener::THandler handler,
+        std::function<void()> onConnected,
+        std::chrono::milliseconds retryInterval);
 
 private:
-    TDbClientPtr Client_;
-    std::shared_ptr<pqxx::transaction<>> Txn_;
+    TDataBaseConfigPtr Config_;
+    std::string ConnectionString_;
+
+    TDbConnectionPoolPtr WritePool_;
+    TDbConnectionPoolPtr ReadPool_;
 
     inline static const std::string LoggingSource = "Client";
 };
 
+DECLARE_REFCOUNTED(TDbClient);
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace NIpc {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! LISTENs on a channel over a dedicated connection and calls `handler`
+//! with every payload from its own thread. `onConnected` is called on the
+//! same thread after each (re)connect and LISTEN: notifications sent while
+//! the listener was not connected are lost, so state is reloaded there.
+class TDbListener
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    using THandler = std::function<void(const std::string& payload)>;
+
+    TDbListener(
+        std::string connectionString,
+        std::string channel,
+        THandler handler,
+        std::function<void()> onConnected,
+        std::chrono::milliseconds retryInterval);
+
+    //! Stops listening, waits up to a second for the thread.
+    ~TDbListener();
+
+    void Start();
+
+private:
+    void ListenLoop();
+
+    const std::string ConnectionString_;
+    const std::string Channel_;
+    const THandler Handler_;
+    const std::function<void()> OnConnected_;
+    const std::chrono::milliseconds RetryInterval_;
+
+    std::atomic<bool> Stopping_ = false;
+    std::thread Thread_;
+};
+
+DECLARE_REFCOUNTED(TDbListener);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NIpc
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+
+#include <pqxx/pqxx>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace NIpc {
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TDbPoolOptions {
+    //! Used in logs only.
+    std::string Name;
+    std::string ConnectionString;
+
+    //! Connections opened upfront and kept open when idle.
+    size_t MinSize = 1;
+    size_t MaxSize = 4;
+
+    //! Sessions of a read-only pool reject writes.
+    bool ReadOnly = false;
+
+    std::chrono::milliseconds AcquireTimeout{5000};
+
+    //! Connections idle for longer are pinged before being handed out.
+    std::chrono::milliseconds HealthCheckInterval{30000};
+
+    //! Idle connections above MinSize are closed after this time.
+    std::chrono::milliseconds IdleTimeout{60000};
+};
+
+class TDbConnectionPool;
+
+DECLARE_REFCOUNTED(TDbConnectionPool);
+
+//! Connection checked out of a pool, it goes back to the pool on destruction.
+//! Broken connections are dropped instead of being returned.
+class TPooledConnection {
+public:
+    struct TConnection {
+        std::unique_ptr<pqxx::connection> Connection;
+        std::set<std::string> Prepared;
+        std::chrono::steady_clock::time_point ReleasedAt;
+    };
+
+    TPooledConnection() = default;
+    TPooledConnection(TDbConnectionPoolPtr pool, std::unique_ptr<TConnection> connection);
+    ~TPooledConnection();
+
+    TPooledConnection(TPooledConnection&& other) noexcept = default;
+    TPooledConnection& operator=(TPooledConnection&& other) noexcept;
+
+    pqxx::connection& Get() const;
+
+private:
+    TDbConnectionPoolPtr Pool_;
+    std::unique_ptr<TConnection> Connection_;
+};
+
+//! Bounded pool of PostgreSQL connections. Registered statements are
+//! prepared lazily on every connection when it is checked out.
+class TDbConnectionPool
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    explicit TDbConnectionPool(TDbPoolOptions options);
+
+    //! Opens MinSize connections.
+    void Start();
+
+    //! Blocks while all MaxSize connections are checked out,
+    //! throws after AcquireTimeout.
+    TPooledConnection Acquire();
+
+    //! Validates the statement on one connection right away.
+    void RegisterStatement(const std::string& name, const std::string& query);
+
+    size_t GetSize() const;
+    size_t GetIdleCount() const;
+
+private:
+    friend class TPooledConnection;
+
+    using TConnection = TPooledConnection::TConnection;
+
+    std::unique_ptr<TConnection> Open() const;
+    bool IsHealthy(TConnection& connection) const;
+    void PrepareStatements(TConnection& connection);
+
+    void Release(std::unique_ptr<TConnection> connection);
+
+    const TDbPoolOptions Options_;
+
+    mutable std::mutex Mutex_;
+    std::condition_variable Released_;
+
+    //! Most recently released connections are at the back.
+    std::deque<std::unique_ptr<TConnection>> Idle_;
+
+    //! Idle and checked out connections.
+    size_t Size_ = 0;
+
+    std::map<std::string, std::string> Statements_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NIpc
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace NIpc {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Compiled statement, reused across executions with Reset.
+class TSqliteStatement {
+public:
+    TSqliteStatement(sqlite3* db, const std::string& query);
+    ~TSqliteStatement();
+
+    TSqliteStatement(const TSqliteStatement&) = delete;
+    TSqliteStatement& operator=(const TSqliteStatement&) = delete;
+
+    //! Parameters are numbered from one, like ?1, ?2, ...
+    void Bind(int index, int64_t value);
+    void Bind(int index, double value);
+
+    //! Runs the statement to the next row, returns false when it is done.
+    bool Step();
+
+    //! Columns of the current row, numbered from zero.
+    int64_t GetInt64(int column) const;
+    double GetDouble(int column) const;
+    bool IsNull(int column) const;
+
+    //! Rewinds the statement and clears the bindings.
+    void Reset();
+
+private:
+    sqlite3* Db_;
+    sqlite3_stmt* Statement_ = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Connection to a database file. Not thread-safe, callers serialize access.
+class TSqliteDb
+    : public NRefCounted::TRefCountedBase
+{
+public:
+    //! Opens the file, creating it if needed.
+    explicit TSqliteDb(const std::filesystem::path& path);
+    ~TSqliteDb();
+
+    //! Runs one or more statements without parameters.
+    void Execute(const std::string& query);
+
+    std::unique_ptr<TSqliteStatement> Prepare(const std::string& query);
+
+    //! Rows changed by the last INSERT, UPDATE or DELETE.
+    int64_t GetChanges() const;
+
+private:
+    sqlite3* Db_ = nullptr;
+};
+
+DECLARE_REFCOUNTED(TSqliteDb);
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! BEGIN IMMEDIATE on construction, rolled back on destruction unless committed.
+class TSqliteTransaction {
+public:
+    explicit TSqliteTransaction(TSqliteDb& db);
+    ~TSqliteTransaction();
+
+    void Commit();
+
+private:
+    TSqliteDb& Db_;
+    bool Finished_ = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NIpc
@@ -218,6 +218,9 @@ public:
     std::string GetVersion() const;
     std::string GetHeader(const std::string& key) const;
 
+    bool HasUrlArg(const std::string& key) const;
+    std::string GetUrlArg(const std::string& key) const;
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
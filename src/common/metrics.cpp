@@ -0,0 +1,175 @@
+#include <common/metrics.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace NMetrics {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+void AtomicAdd(std::atomic<double>& target, double value) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
+void AtomicMax(std::atomic<double>& target, double value) {
+    double current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TCounter::Increment(uint64_t value) {
+    Value_.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t TCounter::Get() const {
+    return Value_.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TGauge::Set(int64_t value) {
+    Value_.store(value, std::memory_order_relaxed);
+}
+
+void TGauge::Add(int64_t value) {
+    Value_.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64_t TGauge::Get() const {
+    return Value_.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+THistogram::THistogram(std::vector<double> bounds)
+    : Bounds_(std::move(bounds)),
+      Counts_(std::make_unique<std::atomic<uint64_t>[]>(Bounds_.size() + 1))
+{
+    std::sort(Bounds_.begin(), Bounds_.end());
+}
+
+void THistogram::Record(double value) {
+    size_t bucket = std::lower_bound(Bounds_.begin(), Bounds_.end(), value) - Bounds_.begin();
+    Counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    Count_.fetch_add(1, std::memory_order_relaxed);
+    AtomicAdd(Sum_, value);
+    AtomicMax(Max_, value);
+}
+
+const std::vector<double>& THistogram::GetBounds() const {
+    return Bounds_;
+}
+
+std::vector<uint64_t> THistogram::GetCumulativeCounts() const {
+    std::vector<uint64_t> result(Bounds_.size() + 1);
+    uint64_t total = 0;
+    for (size_t i = 0; i < result.size(); i++) {
+        total += Counts_[i].load(std::memory_order_relaxed);
+        result[i] = total;
+    }
+    return result;
+}
+
+uint64_t THistogram::GetCount() const {
+    return Count_.load(std::memory_order_relaxed);
+}
+
+double THistogram::GetSum() const {
+    return Sum_.load(std::memory_order_relaxed);
+}
+
+double THistogram::GetMax() const {
+    return Max_.load(std::memory_order_relaxed);
+}
+
+std::vector<double> ExponentialBounds(double max) {
+    std::vector<double> bounds;
+    for (double scale = 1; ; scale *= 10) {
+        for (double step : {1.0, 2.0, 5.0}) {
+            if (step * scale > max) {
+                return bounds;
+            }
+            bounds.push_back(step * scale);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TMetricRegistry& TMetricRegistry::GetInstance() {
+    static TMetricRegistry instance;
+    return instance;
+}
+
+std::shared_ptr<TCounter> TMetricRegistry::GetCounter(const std::string& name) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    auto& counter = Counters_[name];
+    if (!counter) {
+        counter = std::make_shared<TCounter>();
+    }
+    return counter;
+}
+
+std::shared_ptr<TGauge> TMetricRegistry::GetGauge(const std::string& name) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    auto& gauge = Gauges_[name];
+    if (!gauge) {
+        gauge = std::make_shared<TGauge>();
+    }
+    return gauge;
+}
+
+std::shared_ptr<THistogram> TMetricRegistry::GetHistogram(const std::string& name, const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    auto& histogram = Histograms_[name];
+    if (!histogram) {
+        histogram = std::make_shared<THistogram>(bounds);
+    }
+    return histogram;
+}
+
+std::string TMetricRegistry::FormatText() {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    std::ostringstream out;
+
+    for (const auto& [name, counter] : Counters_) {
+        out << "# TYPE " << name << " counter\n";
+        out << name << " " << counter->Get() << "\n";
+    }
+
+    for (const auto& [name, gauge] : Gauges_) {
+        out << "# TYPE " << name << " gauge\n";
+        out << name << " " << gauge->Get() << "\n";
+    }
+
+    for (const auto& [name, histogram] : Histograms_) {
+        const auto& bounds = histogram->GetBounds();
+        auto counts = histogram->GetCumulativeCounts();
+
+        out << "# TYPE " << name << " histogram\n";
+        for (size_t i = 0; i < bounds.size(); i++) {
+            out << name << "_bucket{le=\"" << bounds[i] << "\"} " << counts[i] << "\n";
+        }
+        out << name << "_bucket{le=\"+Inf\"} " << counts.back() << "\n";
+        out << name << "_sum " << histogram->GetSum() << "\n";
+        out << name << "_count " << histogram->GetCount() << "\n";
+        out << "# TYPE " << name << "_max gauge\n";
+        out << name << "_max " << histogram->GetMax() << "\n";
+    }
+
+    return out.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NMetrics
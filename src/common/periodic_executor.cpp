@@ -3,8 +3,6 @@
 #include <common/threadpool.h>
 #include <common/weak_ptr.h>
 
-#include <thread>
-
 namespace NCommon {
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -23,7 +21,11 @@ void TPeriodicExecutor::Start() {
 }
 
 void TPeriodicExecutor::Stop() {
-    StopFlag_.store(true, std::memory_order_relaxed);
+    {
+        auto guard = std::lock_guard(StopMutex_);
+        StopFlag_.store(true, std::memory_order_relaxed);
+    }
+    StopCondition_.notify_all();
 }
 
 void TPeriodicExecutor::ScheduleNext() {
@@ -47,7 +49,10 @@ void TPeriodicExecutor::Worker() {
         return;
     }
 
-    std::this_thread::sleep_for(Delay_);
+    {
+        auto lock = std::unique_lock(StopMutex_);
+        StopCondition_.wait_for(lock, Delay_, [&] { return StopFlag_.load(std::memory_order_relaxed); });
+    }
     ScheduleNext();
 }
 
@@ -1,6 +1,6 @@
 #include <ipc/db_client.h>
 
-#include <thread>
+#include <sstream>
 
 namespace NIpc {
 
@@ -52,27 +52,165 @@ void TDataBaseConfig::Load(const nlohmann::json& data) {
         }
     }
     ASSERT(!Password.empty(), "No password provided for user '{}'", UserName);
-}
 
-////////////////////////////////////////////////////////////////////////////////
+    MaxBatchSize = TConfigBase::Load<uint32_t>(data, "max_batch_size", 1);
+    MaxBatchLatency = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "max_batch_latency_ms", 1000));
+
+    PoolMinSize = TConfigBase::Load<uint32_t>(data, "pool_min_size", 1);
+    PoolMaxSize = TConfigBase::Load<uint32_t>(data, "pool_max_size", 4);
+    ReadPoolMaxSize = TConfigBase::Load<uint32_t>(data, "read_pool_max_size", 2);
+    ASSERT(PoolMaxSize > 0 && ReadPoolMaxSize > 0, "Connection pools must allow at least one connection");
+    PoolAcquireTimeout = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "pool_acquire_timeout_ms", 5000));
+    PoolHealthCheckInterval = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "pool_health_check_interval_ms", 30000));
+    PoolIdleTimeout = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "pool_idle_timeout_ms", 60000));
+
+    Partitioned = TConfigBase::Load<bool>(data, "partitioned", false);
+    PartitionsAhead = TConfigBase::Load<uint32_t>(data, "partitions_ahead", 2);
+
+    RetentionInterval = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "retention_interval_ms", 60000));
+    RetentionBatchSize = TConfigBase::Load<uint32_t>(data, "retention_batch_size", 10000);
+    ASSERT(RetentionBatchSize > 0, "retention_batch_size must be positive");
+
+    Pushdown = TConfigBase::Load<bool>(data, "pushdown", false);
+    HotWindow = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "hot_window_ms", 3600000));
+
+    Follower = TConfigBase::Load<bool>(data, "follower", false);
+    NotifyFollowers = TConfigBase::Load<bool>(data, "notify_followers", false);
+    ASSERT(!Follower || !NotifyFollowers, "A follower does not write, notify_followers is for the writer");
+
+    SpoolPath = TConfigBase::Load<std::string>(data, "spool_path", "data/db_spool.bin");
+    SpoolReplayBatchSize = TConfigBase::Load<uint32_t>(data, "spool_replay_batch_size", 10000);
+    ASSERT(SpoolReplayBatchSize > 0, "spool_replay_batch_size must be positive");
+    SpoolRetryInterval = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "spool_retry_interval_ms", 5000));
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
 TDbClient::TDbClient(TDataBaseConfigPtr config)
-    : Config_(config) {}
+    : Config_(config)
+{
+    ConnectionString_ = NCommon::Format("hostaddr={} port={} dbname={} user={} password={} requiressl={}",
+        Config_->HostAddr, Config_->Port, Config_->DbName, Config_->UserName, Config_->Password, Config_->RequireSsl);
+
+    TDbPoolOptions options;
+    options.ConnectionString = ConnectionString_;
+    options.MinSize = Config_->PoolMinSize;
+    options.AcquireTimeout = Config_->PoolAcquireTimeout;
+    options.HealthCheckInterval = Config_->PoolHealthCheckInterval;
+    options.IdleTimeout = Config_->PoolIdleTimeout;
+
+    options.Name = "write";
+    options.MaxSize = Config_->PoolMaxSize;
+    WritePool_ = NCommon::New<TDbConnectionPool>(options);
+
+    options.Name = "read";
+    options.MaxSize = Config_->ReadPoolMaxSize;
+    options.ReadOnly = true;
+    ReadPool_ = NCommon::New<TDbConnectionPool>(options);
+}
 
 void TDbClient::Connect() {
     try {
-        Conn_ = std::make_unique<pqxx::connection>(
-            NCommon::Format("hostaddr={} port={} dbname={} user={} password={} requiressl={}",
-                Config_->HostAddr, Config_->Port, Config_->DbName, Config_->UserName, Config_->Password, Config_->RequireSsl));
+        WritePool_->Start();
+        ReadPool_->Start();
         LOG_INFO("Connected to PostgreSQL database: {}", Config_->DbName);
     } catch (const std::exception& ex) {
         RETHROW(ex, "Database connection failed");
     }
 }
 
+void TDbClient::RegisterStatement(const std::string& name, const std::string& query) {
+    WritePool_->RegisterStatement(name, query);
+}
+
 void TDbClient::InsertRow(const std::string& table, const TParamMap& columns) {
+    auto txn = BeginAutocommit();
+    txn.InsertRow(table, columns);
+    txn.Commit();
+}
+
+void TDbClient::DeleteRow(const std::string& table, const std::string& conditions) {
+    auto txn = BeginAutocommit();
+    txn.DeleteRow(table, conditions);
+    txn.Commit();
+}
+
+pqxx::result TDbClient::SelectRows(const std::string& table,
+                                  const std::string& conditions,
+                                  const TQueryParams& orderBy,
+                                  int limit) 
+{
+    auto txn = BeginReadTransaction();
+    auto res = txn.SelectRows(table, conditions, orderBy, limit);
+    txn.Commit();
+    return res;
+}
+
+TTransaction TDbClient::BeginTransaction() {
+    return TTransaction(WritePool_->Acquire(), ETransactionMode::ReadWrite);
+}
+
+TTransaction TDbClient::BeginReadTransaction() {
+    return TTransaction(ReadPool_->Acquire(), ETransactionMode::ReadOnly);
+}
+
+TTransaction TDbClient::BeginAutocommit() {
+    return TTransaction(WritePool_->Acquire(), ETransactionMode::Autocommit);
+}
+
+TDbListenerPtr TDbClient::CreateListener(
+    const std::string& channel,
+    TDbListener::THandler handler,
+    std::function<void()> onConnected,
+    std::chrono::milliseconds retryInterval)
+{
+    return NCommon::New<TDbListener>(ConnectionString_, channel, std::move(handler), std::move(onConnected), retryInterval);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TTransaction::TTransaction(TPooledConnection connection, ETransactionMode mode)
+    : Connection_(std::move(connection))
+{
+    try {
+        switch (mode) {
+            case ETransactionMode::ReadWrite:
+                Txn_ = std::make_unique<pqxx::work>(Connection_.Get());
+                break;
+            case ETransactionMode::ReadOnly:
+                Txn_ = std::make_unique<pqxx::read_transaction>(Connection_.Get());
+                break;
+            case ETransactionMode::Autocommit:
+                Txn_ = std::make_unique<pqxx::nontransaction>(Connection_.Get());
+                break;
+        }
+        LOG_DEBUG("Transaction started");
+    } catch (const std::exception& ex) {
+        RETHROW(ex, "Failed to begin transaction");
+    }
+}
+
+TTransaction::~TTransaction() {
+    try {
+        if (Txn_) {
+            LOG_WARNING("Transaction was not explicitly committed or rolled back, rolling back");
+            Rollback();
+        }
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Failed to rollback transaction in destructor: {}", ex.what());
+    }
+}
+
+pqxx::result TTransaction::ExecuteQuery(const std::string& query, pqxx::params&& params) {
+    try {
+        return GetTxn().exec(query, params);
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Parameterized query failed: {}", ex.what());
+        throw;
+    }
+}
+
+void TTransaction::InsertRow(const std::string& table, const TParamMap& columns) {
     auto splited = SplitMap(columns);
 
     ExecuteQueryR(
@@ -83,7 +221,7 @@ void TDbClient::InsertRow(const std::string& table, const TParamMap& columns) {
     );
 }
 
-void TDbClient::DeleteRow(const std::string& table, const std::string& conditions) {
+void TTransaction::DeleteRow(const std::string& table, const std::string& conditions) {
     std::string query = "DELETE FROM " + table;
     if (!conditions.empty()) {
         query += " WHERE " + conditions;
@@ -91,10 +229,10 @@ void TDbClient::DeleteRow(const std::string& table, const std::string& condition
     ExecuteQuery(query);
 }
 
-pqxx::result TDbClient::SelectRows(const std::string& table,
-                                  const std::string& conditions,
-                                  const TQueryParams& orderBy,
-                                  int limit) 
+pqxx::result TTransaction::SelectRows(const std::string& table,
+                                      const std::string& conditions,
+                                      const TQueryParams& orderBy,
+                                      int limit)
 {
     std::string query = "SELECT * FROM " + table;
     
@@ -116,102 +254,40 @@ pqxx::result TDbClient::SelectRows(const std::string& table,
     return ExecuteQuery(query);
 }
 
-TTransaction TDbClient::BeginTransaction() {
-    std::lock_guard<std::mutex> lock(Mutex_);
-    if (Txn_) {
-        THROW("Another transaction is already active");
-    }
-    
-    try {
-        Txn_ = std::make_shared<pqxx::transaction<>>(*Conn_);
-        LOG_DEBUG("Transaction started");
-        return TTransaction(NCommon::TIntrusivePtr<TDbClient>(this), Txn_);
-    } catch (const std::exception& ex) {
-        RETHROW(ex, "Failed to begin transaction");
-    }
-}
-
-TTransaction TDbClient::BeginTransactionWithTimeout(std::chrono::milliseconds timeout) {
-    auto endTime = std::chrono::steady_clock::now() + timeout;
-    
-    while (true) {
-        {
-            std::unique_lock<std::mutex> lock(Mutex_);
-            if (!Txn_) {
-                try {
-                    Txn_ = std::make_shared<pqxx::transaction<>>(*Conn_);
-                    LOG_DEBUG("Transaction started after waiting");
-                    return TTransaction(NCommon::TIntrusivePtr<TDbClient>(this), Txn_);
-                } catch (const std::exception& ex) {
-                    RETHROW(ex, "Failed to begin transaction");
-                }
-            }
-            
-            if (std::chrono::steady_clock::now() >= endTime) {
-                THROW("Timed out waiting for previous transaction to complete");
-            }
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
-}
-
-void TDbClient::Commit() {
-    std::lock_guard<std::mutex> lock(Mutex_);
+void TTransaction::Commit() {
     if (!Txn_) {
         THROW("No active transaction to commit");
     }
-    
+
+    // The transaction is closed either way, a failed commit is not retried.
+    auto txn = std::move(Txn_);
     try {
-        Txn_->commit();
+        txn->commit();
         LOG_DEBUG("Transaction committed");
-        Txn_.reset();
     } catch (const std::exception& ex) {
         RETHROW(ex, "Failed to commit transaction");
     }
 }
 
-void TDbClient::Rollback() {
-    std::lock_guard<std::mutex> lock(Mutex_);
+void TTransaction::Rollback() {
     if (!Txn_) {
         THROW("No active transaction to rollback");
     }
-    
+
+    auto txn = std::move(Txn_);
     try {
-        Txn_->abort();
+        txn->abort();
         LOG_DEBUG("Transaction rolled back");
-        Txn_.reset();
     } catch (const std::exception& ex) {
         RETHROW(ex, "Failed to rollback transaction");
     }
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-TTransaction::TTransaction(TDbClientPtr client, std::shared_ptr<pqxx::transaction<>> Txn)
-    : Client_(std::move(client)),
-      Txn_(Txn)
-{}
-
-TTransaction::~TTransaction() {
-    try {
-        if (Client_ && Client_->Txn_ && Client_->Txn_ == Txn_) {
-            LOG_WARNING("Transaction was not explicitly committed or rolled back, rolling back");
-            Client_->Rollback();
-        }
-    } catch (const std::exception& ex) {
-        LOG_ERROR("Failed to rollback transaction in destructor: {}", ex.what());
-    }
-}
-
-void TTransaction::Commit() {
-    Client_->Commit();
-}
-
-void TTransaction::Rollback() {
-    Client_->Rollback();
+pqxx::transaction_base& TTransaction::GetTxn() {
+    ASSERT(Txn_, "Transaction is already finished");
+    return *Txn_;
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NIpc
@@ -0,0 +1,73 @@
+#include <ipc/db_listener.h>
+
+#include <common/logging.h>
+
+#include <pqxx/pqxx>
+
+namespace NIpc {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "Listener";
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TDbListener::TDbListener(
+    std::string connectionString,
+    std::string channel,
+    THandler handler,
+    std::function<void()> onConnected,
+    std::chrono::milliseconds retryInterval)
+    : ConnectionString_(std::move(connectionString)),
+      Channel_(std::move(channel)),
+      Handler_(std::move(handler)),
+      OnConnected_(std::move(onConnected)),
+      RetryInterval_(retryInterval)
+{}
+
+TDbListener::~TDbListener() {
+    Stopping_ = true;
+    if (Thread_.joinable()) {
+        Thread_.join();
+    }
+}
+
+void TDbListener::Start() {
+    Thread_ = std::thread(&TDbListener::ListenLoop, this);
+}
+
+void TDbListener::ListenLoop() {
+    while (!Stopping_) {
+        try {
+            pqxx::connection connection(ConnectionString_);
+            connection.listen(Channel_, [this] (pqxx::notification notification) {
+                Handler_(std::string(notification.payload));
+            });
+            LOG_INFO("Listening on channel {}", Channel_);
+
+            OnConnected_();
+
+            while (!Stopping_) {
+                // Wakes up every second to check for stop
+                connection.await_notification(1, 0);
+            }
+        } catch (const std::exception& ex) {
+            LOG_WARNING("Listening on channel {} failed, reconnecting: {}", Channel_, ex);
+        }
+
+        // Sleeps in short steps so stop is not delayed by the retry interval
+        for (auto slept = std::chrono::milliseconds::zero(); !Stopping_ && slept < RetryInterval_; slept += std::chrono::milliseconds(100)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NIpc
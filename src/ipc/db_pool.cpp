@@ -0,0 +1,224 @@
+#include <ipc/db_pool.h>
+
+#include <common/exception.h>
+#include <common/logging.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace NIpc {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "DbPool";
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TPooledConnection::TPooledConnection(TDbConnectionPoolPtr pool, std::unique_ptr<TConnection> connection)
+    : Pool_(std::move(pool)),
+      Connection_(std::move(connection))
+{}
+
+TPooledConnection::~TPooledConnection() {
+    if (Pool_ && Connection_) {
+        Pool_->Release(std::move(Connection_));
+    }
+}
+
+TPooledConnection& TPooledConnection::operator=(TPooledConnection&& other) noexcept {
+    if (this != &other) {
+        if (Pool_ && Connection_) {
+            Pool_->Release(std::move(Connection_));
+        }
+        Pool_ = std::move(other.Pool_);
+        Connection_ = std::move(other.Connection_);
+    }
+    return *this;
+}
+
+pqxx::connection& TPooledConnection::Get() const {
+    ASSERT(Connection_, "Connection is not checked out");
+    return *Connection_->Connection;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TDbConnectionPool::TDbConnectionPool(TDbPoolOptions options)
+    : Options_(std::move(options))
+{
+    ASSERT(Options_.MaxSize > 0, "Pool '{}' must allow at least one connection", Options_.Name);
+}
+
+void TDbConnectionPool::Start() {
+    const size_t minSize = std::min(Options_.MinSize, Options_.MaxSize);
+    for (size_t i = 0; i < minSize; i++) {
+        auto connection = Open();
+        auto guard = std::lock_guard(Mutex_);
+        Idle_.push_back(std::move(connection));
+        Size_++;
+    }
+    LOG_INFO("Pool '{}' started with {} connections, at most {}", Options_.Name, minSize, Options_.MaxSize);
+}
+
+TPooledConnection TDbConnectionPool::Acquire() {
+    const auto deadline = std::chrono::steady_clock::now() + Options_.AcquireTimeout;
+
+    while (true) {
+        std::unique_ptr<TConnection> connection;
+        {
+            auto lock = std::unique_lock(Mutex_);
+            bool ready = Released_.wait_until(lock, deadline, [&] {
+                return !Idle_.empty() || Size_ < Options_.MaxSize;
+            });
+            if (!ready) {
+                THROW("Timed out waiting for a connection from pool '{}', all {} are in use", Options_.Name, Size_);
+            }
+
+            if (!Idle_.empty()) {
+                connection = std::move(Idle_.back());
+                Idle_.pop_back();
+            }
+            // Reserve the slot, it is given back if opening fails.
+            if (!connection) {
+                Size_++;
+            }
+        }
+
+        if (connection && !IsHealthy(*connection)) {
+            LOG_WARNING("Dropping broken connection from pool '{}'", Options_.Name);
+            connection.reset();
+            auto guard = std::lock_guard(Mutex_);
+            Size_--;
+            Released_.notify_one();
+            continue;
+        }
+
+        try {
+            if (!connection) {
+                connection = Open();
+            }
+            PrepareStatements(*connection);
+        } catch (...) {
+            connection.reset();
+            auto guard = std::lock_guard(Mutex_);
+            Size_--;
+            Released_.notify_one();
+            throw;
+        }
+
+        return TPooledConnection(TDbConnectionPoolPtr(this), std::move(connection));
+    }
+}
+
+void TDbConnectionPool::RegisterStatement(const std::string& name, const std::string& query) {
+    {
+        auto guard = std::lock_guard(Mutex_);
+        Statements_[name] = query;
+    }
+    Acquire();
+}
+
+size_t TDbConnectionPool::GetSize() const {
+    auto guard = std::lock_guard(Mutex_);
+    return Size_;
+}
+
+size_t TDbConnectionPool::GetIdleCount() const {
+    auto guard = std::lock_guard(Mutex_);
+    return Idle_.size();
+}
+
+std::unique_ptr<TDbConnectionPool::TConnection> TDbConnectionPool::Open() const {
+    try {
+        auto connection = std::make_unique<TConnection>();
+        connection->Connection = std::make_unique<pqxx::connection>(Options_.ConnectionString);
+        connection->ReleasedAt = std::chrono::steady_clock::now();
+        if (Options_.ReadOnly) {
+            pqxx::nontransaction txn(*connection->Connection);
+            txn.exec("SET SESSION CHARACTERISTICS AS TRANSACTION READ ONLY");
+        }
+        LOG_DEBUG("Opened connection for pool '{}'", Options_.Name);
+        return connection;
+    } catch (const std::exception& ex) {
+        RETHROW(ex, "Failed to open connection for pool '{}'", Options_.Name);
+    }
+}
+
+bool TDbConnectionPool::IsHealthy(TConnection& connection) const {
+    if (!connection.Connection->is_open()) {
+        return false;
+    }
+    if (std::chrono::steady_clock::now() - connection.ReleasedAt < Options_.HealthCheckInterval) {
+        return true;
+    }
+    try {
+        pqxx::nontransaction txn(*connection.Connection);
+        txn.exec("SELECT 1");
+        return true;
+    } catch (const std::exception& ex) {
+        LOG_WARNING("Health check failed for pool '{}': {}", Options_.Name, ex.what());
+        return false;
+    }
+}
+
+void TDbConnectionPool::PrepareStatements(TConnection& connection) {
+    std::map<std::string, std::string> statements;
+    {
+        auto guard = std::lock_guard(Mutex_);
+        if (connection.Prepared.size() == Statements_.size()) {
+            return;
+        }
+        statements = Statements_;
+    }
+
+    for (const auto& [name, query] : statements) {
+        if (connection.Prepared.contains(name)) {
+            continue;
+        }
+        try {
+            connection.Connection->prepare(name, query);
+            connection.Prepared.insert(name);
+        } catch (const std::exception& ex) {
+            RETHROW(ex, "Failed to prepare statement '{}'", name);
+        }
+    }
+}
+
+void TDbConnectionPool::Release(std::unique_ptr<TConnection> connection) {
+    const auto now = std::chrono::steady_clock::now();
+    const bool broken = !connection->Connection->is_open();
+    connection->ReleasedAt = now;
+
+    std::vector<std::unique_ptr<TConnection>> closed;
+    {
+        auto guard = std::lock_guard(Mutex_);
+        if (broken) {
+            closed.push_back(std::move(connection));
+            Size_--;
+        } else {
+            Idle_.push_back(std::move(connection));
+        }
+
+        // The oldest idle connections are at the front.
+        while (Size_ > Options_.MinSize && !Idle_.empty() && now - Idle_.front()->ReleasedAt > Options_.IdleTimeout) {
+            closed.push_back(std::move(Idle_.front()));
+            Idle_.pop_front();
+            Size_--;
+        }
+        Released_.notify_one();
+    }
+
+    if (broken) {
+        LOG_WARNING("Dropped broken connection returned to pool '{}'", Options_.Name);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NIpc
@@ -0,0 +1,132 @@
+#include <ipc/sqlite_db.h>
+
+#include <common/logging.h>
+#include <common/exception.h>
+
+#include <sqlite3.h>
+
+namespace NIpc {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "Sqlite";
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSqliteStatement::TSqliteStatement(sqlite3* db, const std::string& query)
+    : Db_(db)
+{
+    if (sqlite3_prepare_v3(Db_, query.c_str(), query.size() + 1, SQLITE_PREPARE_PERSISTENT, &Statement_, nullptr) != SQLITE_OK) {
+        THROW("Failed to prepare '{}': {}", query, sqlite3_errmsg(Db_));
+    }
+}
+
+TSqliteStatement::~TSqliteStatement() {
+    sqlite3_finalize(Statement_);
+}
+
+void TSqliteStatement::Bind(int index, int64_t value) {
+    if (sqlite3_bind_int64(Statement_, index, value) != SQLITE_OK) {
+        THROW("Failed to bind parameter {}: {}", index, sqlite3_errmsg(Db_));
+    }
+}
+
+void TSqliteStatement::Bind(int index, double value) {
+    if (sqlite3_bind_double(Statement_, index, value) != SQLITE_OK) {
+        THROW("Failed to bind parameter {}: {}", index, sqlite3_errmsg(Db_));
+    }
+}
+
+bool TSqliteStatement::Step() {
+    switch (sqlite3_step(Statement_)) {
+        case SQLITE_ROW:
+            return true;
+        case SQLITE_DONE:
+            return false;
+        default:
+            THROW("Statement '{}' failed: {}", sqlite3_sql(Statement_), sqlite3_errmsg(Db_));
+    }
+}
+
+int64_t TSqliteStatement::GetInt64(int column) const {
+    return sqlite3_column_int64(Statement_, column);
+}
+
+double TSqliteStatement::GetDouble(int column) const {
+    return sqlite3_column_double(Statement_, column);
+}
+
+bool TSqliteStatement::IsNull(int column) const {
+    return sqlite3_column_type(Statement_, column) == SQLITE_NULL;
+}
+
+void TSqliteStatement::Reset() {
+    sqlite3_reset(Statement_);
+    sqlite3_clear_bindings(Statement_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSqliteDb::TSqliteDb(const std::filesystem::path& path) {
+    if (sqlite3_open_v2(path.c_str(), &Db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+        std::string error = Db_ ? sqlite3_errmsg(Db_) : "out of memory";
+        sqlite3_close_v2(Db_);
+        THROW("Failed to open {}: {}", path, error);
+    }
+    LOG_INFO("Opened {}", path);
+}
+
+TSqliteDb::~TSqliteDb() {
+    sqlite3_close_v2(Db_);
+}
+
+void TSqliteDb::Execute(const std::string& query) {
+    char* error = nullptr;
+    if (sqlite3_exec(Db_, query.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+        std::string message = error ? error : sqlite3_errmsg(Db_);
+        sqlite3_free(error);
+        THROW("Query '{}' failed: {}", query, message);
+    }
+}
+
+std::unique_ptr<TSqliteStatement> TSqliteDb::Prepare(const std::string& query) {
+    return std::make_unique<TSqliteStatement>(Db_, query);
+}
+
+int64_t TSqliteDb::GetChanges() const {
+    return sqlite3_changes64(Db_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSqliteTransaction::TSqliteTransaction(TSqliteDb& db)
+    : Db_(db)
+{
+    Db_.Execute("BEGIN IMMEDIATE");
+}
+
+TSqliteTransaction::~TSqliteTransaction() {
+    if (Finished_) {
+        return;
+    }
+    try {
+        Db_.Execute("ROLLBACK");
+    } catch (const std::exception& ex) {
+        LOG_WARNING("Failed to roll back: {}", ex);
+    }
+}
+
+void TSqliteTransaction::Commit() {
+    Db_.Execute("COMMIT");
+    Finished_ = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NIpc
@@ -208,8 +208,8 @@ TRequest::TRequest(const std::string& recievedData) {
     {
         for (auto args : Split(urlSplit[1], "&"))
         {
-            auto sp = Split(args, "=");
-            UrlArgs_[sp[0]] = sp[1];
+            auto sp = Split(args, "=", 2);
+            UrlArgs_[sp[0]] = sp.size() > 1 ? sp[1] : "";
         }
     }
     Version_ = split[2];
@@ -239,6 +239,14 @@ std::string TRequest::GetHeader(const std::string& key) const {
     return Headers_.contains(key) ? Headers_.at(key) : "";
 }
 
+bool TRequest::HasUrlArg(const std::string& key) const {
+    return UrlArgs_.contains(key);
+}
+
+std::string TRequest::GetUrlArg(const std::string& key) const {
+    return UrlArgs_.contains(key) ? UrlArgs_.at(key) : "";
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 THandlerBase::THandlerBase(const std::string& version)
@@ -0,0 +1,137 @@
+#include <service/async_writer.h>
+
+#include <common/logging.h>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "AsyncWriter";
+
+int64_t ToMicroseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TAsyncWriteStorage::TAsyncWriteStorage(std::unique_ptr<TTemperatureStorage> storage, NConfig::TAsyncWriterConfigPtr config)
+    : Storage_(std::move(storage)),
+      Config_(std::move(config)),
+      QueueDepth_(NMetrics::GetMetricRegistry().GetGauge("storage_writer_queue_depth")),
+      QueueLatency_(NMetrics::GetMetricRegistry().GetHistogram("storage_writer_queue_latency_us", NMetrics::ExponentialBounds(1e8))),
+      WriteLatency_(NMetrics::GetMetricRegistry().GetHistogram("storage_writer_write_latency_us", NMetrics::ExponentialBounds(1e7))),
+      Dropped_(NMetrics::GetMetricRegistry().GetCounter("storage_writer_dropped")),
+      Coalesced_(NMetrics::GetMetricRegistry().GetCounter("storage_writer_coalesced"))
+{
+    Writer_ = std::thread(&TAsyncWriteStorage::WriterLoop, this);
+}
+
+TAsyncWriteStorage::~TAsyncWriteStorage() {
+    {
+        auto guard = std::lock_guard(Mutex_);
+        Stopping_ = true;
+    }
+    Queued_.notify_one();
+    Writer_.join();
+}
+
+TReadingSeries TAsyncWriteStorage::GetRawReadings() {
+    return Storage_->GetRawReadings();
+}
+
+TReadingSeries TAsyncWriteStorage::GetHourlyAverage() {
+    return Storage_->GetHourlyAverage();
+}
+
+TReadingSeries TAsyncWriteStorage::GetDailyAverage() {
+    return Storage_->GetDailyAverage();
+}
+
+TReadingSeries TAsyncWriteStorage::GetRange(
+    EReadingsTier tier,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t limit)
+{
+    return Storage_->GetRange(tier, from, to, limit);
+}
+
+std::optional<TPyramidSlice> TAsyncWriteStorage::GetAggregates(
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t minPoints)
+{
+    return Storage_->GetAggregates(from, to, minPoints);
+}
+
+void TAsyncWriteStorage::ProcessTemperature(const TReading& reading) {
+    const auto now = std::chrono::steady_clock::now();
+    {
+        auto lock = std::unique_lock(Mutex_);
+
+        if (Queue_.size() >= Config_->QueueSize) {
+            switch (Config_->Overflow) {
+                case NConfig::EOverflowPolicy::Block:
+                    Dequeued_.wait(lock, [&] { return Queue_.size() < Config_->QueueSize; });
+                    break;
+
+                case NConfig::EOverflowPolicy::DropOldest:
+                    Queue_.pop_front();
+                    Dropped_->Increment();
+                    break;
+
+                case NConfig::EOverflowPolicy::Coalesce: {
+                    auto& newest = Queue_.back();
+                    newest.Reading.temperature = (newest.Reading.temperature * newest.Count + reading.temperature) / (newest.Count + 1);
+                    newest.Reading.timestamp = reading.timestamp;
+                    newest.Count++;
+                    Coalesced_->Increment();
+                    return;
+                }
+            }
+        }
+
+        Queue_.push_back({reading, 1, now});
+        QueueDepth_->Set(Queue_.size());
+    }
+    Queued_.notify_one();
+}
+
+void TAsyncWriteStorage::WriterLoop() {
+    auto lock = std::unique_lock(Mutex_);
+
+    while (true) {
+        Queued_.wait(lock, [&] { return Stopping_ || !Queue_.empty(); });
+        if (Queue_.empty()) {
+            break;
+        }
+
+        auto queued = Queue_.front();
+        Queue_.pop_front();
+        QueueDepth_->Set(Queue_.size());
+        lock.unlock();
+        Dequeued_.notify_one();
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            Storage_->ProcessTemperature(queued.Reading);
+        } catch (const std::exception& ex) {
+            LOG_ERROR("Failed to write reading: {}", ex);
+        }
+        auto end = std::chrono::steady_clock::now();
+        QueueLatency_->Record(ToMicroseconds(start - queued.EnqueuedAt));
+        WriteLatency_->Record(ToMicroseconds(end - start));
+
+        lock.lock();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <service/storage.h>
+#include <service/config.h>
+
+#include <common/metrics.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Decouples ingestion from a slow storage: ProcessTemperature only puts the
+//! reading into a bounded queue and a writer thread hands it to the wrapped
+//! storage. Reads go straight to the wrapped storage, so queued readings are
+//! not visible until they are written. The queue is drained on destruction.
+class TAsyncWriteStorage
+    : public TTemperatureStorage
+{
+public:
+    TAsyncWriteStorage(std::unique_ptr<TTemperatureStorage> storage, NConfig::TAsyncWriterConfigPtr config);
+    ~TAsyncWriteStorage() override;
+
+    TReadingSeries GetRawReadings() override;
+    TReadingSeries GetHourlyAverage() override;
+    TReadingSeries GetDailyAverage() override;
+
+    TReadingSeries GetRange(
+        EReadingsTier tier,
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t limit) override;
+
+    std::optional<TPyramidSlice> GetAggregates(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t minPoints) override;
+
+    void ProcessTemperature(const TReading& reading) override;
+
+private:
+    struct TQueuedReading {
+        TReading Reading;
+        //! Readings averaged into this one by the coalesce policy.
+        uint64_t Count = 1;
+        std::chrono::steady_clock::time_point EnqueuedAt;
+    };
+
+    void WriterLoop();
+
+    const std::unique_ptr<TTemperatureStorage> Storage_;
+    const NConfig::TAsyncWriterConfigPtr Config_;
+
+    std::mutex Mutex_;
+    //! Signalled when a reading is queued or the writer is stopping.
+    std::condition_variable Queued_;
+    //! Signalled when the writer frees a slot.
+    std::condition_variable Dequeued_;
+    std::deque<TQueuedReading> Queue_;
+    bool Stopping_ = false;
+
+    std::shared_ptr<NMetrics::TGauge> QueueDepth_;
+    std::shared_ptr<NMetrics::THistogram> QueueLatency_;
+    std::shared_ptr<NMetrics::THistogram> WriteLatency_;
+    std::shared_ptr<NMetrics::TCounter> Dropped_;
+    std::shared_ptr<NMetrics::TCounter> Coalesced_;
+
+    std::thread Writer_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,87 @@
+#include <service/batch_writer.h>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+TBatchWriter::TBatchWriter(const std::string& name, uint32_t maxBatchSize, std::chrono::milliseconds maxBatchLatency, TWrite write)
+    : MaxBatchSize_(maxBatchSize),
+      MaxBatchLatency_(maxBatchLatency),
+      Write_(std::move(write)),
+      BatchLatency_(NMetrics::GetMetricRegistry().GetHistogram(name + "_batch_latency_us", NMetrics::ExponentialBounds(1e7))),
+      BatchSize_(NMetrics::GetMetricRegistry().GetHistogram(name + "_batch_size", NMetrics::ExponentialBounds(1e5))),
+      PendingRecords_(NMetrics::GetMetricRegistry().GetGauge(name + "_pending_records"))
+{
+    if (MaxBatchSize_ > 1) {
+        Flusher_ = std::thread(&TBatchWriter::FlusherLoop, this);
+    }
+}
+
+TBatchWriter::~TBatchWriter() {
+    if (!Flusher_.joinable()) {
+        return;
+    }
+
+    {
+        auto guard = std::lock_guard(PendingMutex_);
+        Stopping_ = true;
+    }
+    PendingCondition_.notify_one();
+    Flusher_.join();
+}
+
+void TBatchWriter::Add(const TReading& reading) {
+    if (MaxBatchSize_ <= 1) {
+        Write({&reading, 1});
+        return;
+    }
+
+    {
+        auto guard = std::lock_guard(PendingMutex_);
+        if (Pending_.empty()) {
+            PendingSince_ = std::chrono::steady_clock::now();
+        }
+        Pending_.push_back(reading);
+        PendingRecords_->Set(Pending_.size());
+    }
+    PendingCondition_.notify_one();
+}
+
+void TBatchWriter::FlusherLoop() {
+    auto lock = std::unique_lock(PendingMutex_);
+
+    while (true) {
+        auto full = [&] { return Stopping_ || Pending_.size() >= MaxBatchSize_; };
+        if (Pending_.empty()) {
+            PendingCondition_.wait(lock, [&] { return Stopping_ || !Pending_.empty(); });
+        }
+        if (!Pending_.empty()) {
+            PendingCondition_.wait_until(lock, PendingSince_ + MaxBatchLatency_, full);
+        }
+
+        auto batch = std::exchange(Pending_, {});
+        bool stopping = Stopping_;
+        PendingRecords_->Set(0);
+        lock.unlock();
+
+        if (!batch.empty()) {
+            Write(batch);
+        }
+
+        lock.lock();
+        if (stopping && Pending_.empty()) {
+            break;
+        }
+    }
+}
+
+void TBatchWriter::Write(std::span<const TReading> readings) {
+    auto start = std::chrono::steady_clock::now();
+    Write_(readings);
+    BatchLatency_->Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    BatchSize_->Record(readings.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
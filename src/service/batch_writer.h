@@ -0,0 +1,61 @@
+#pragma once
+
+#include <service/reading.h>
+
+#include <common/metrics.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Buffers the readings of a storage and passes them to `write` in batches.
+//! With `maxBatchSize` above one a flusher thread writes a batch once it is
+//! full or its oldest reading has waited `maxBatchLatency`, otherwise every
+//! reading is written on the calling thread. Writes go to
+//! `<name>_batch_latency_us` and `<name>_batch_size`.
+class TBatchWriter {
+public:
+    using TWrite = std::function<void(std::span<const TReading>)>;
+
+    TBatchWriter(const std::string& name, uint32_t maxBatchSize, std::chrono::milliseconds maxBatchLatency, TWrite write);
+
+    //! Writes the pending readings.
+    ~TBatchWriter();
+
+    void Add(const TReading& reading);
+
+private:
+    void FlusherLoop();
+    void Write(std::span<const TReading> readings);
+
+    const uint32_t MaxBatchSize_;
+    const std::chrono::milliseconds MaxBatchLatency_;
+    TWrite Write_;
+
+    std::mutex PendingMutex_;
+    std::condition_variable PendingCondition_;
+    std::vector<TReading> Pending_;
+    std::chrono::steady_clock::time_point PendingSince_;
+    bool Stopping_ = false;
+
+    std::shared_ptr<NMetrics::THistogram> BatchLatency_;
+    std::shared_ptr<NMetrics::THistogram> BatchSize_;
+    std::shared_ptr<NMetrics::TGauge> PendingRecords_;
+
+    std::thread Flusher_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,326 @@
+#include <service/columnar_series.h>
+#include <service/gorilla.h>
+
+#include <algorithm>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+//! Smallest millisecond timestamp that is not older than `timestamp`.
+int64_t CeilMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::ceil<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromMilliseconds(int64_t timestampMs) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TReading> TColumnarSeries::TSealedBlock::Decode() const {
+    std::vector<TReading> result;
+    result.reserve(Count);
+
+    TGorillaDecoder decoder(Data, Count);
+    int64_t timestampMs;
+    double value;
+    while (decoder.Next(timestampMs, value)) {
+        result.push_back({FromMilliseconds(timestampMs), value});
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TColumnarSeries::const_iterator::const_iterator(const TColumnarSeries* series, size_t block, size_t position)
+    : Series_(series), Block_(block), Position_(position)
+{
+    Load();
+}
+
+TColumnarSeries::const_iterator& TColumnarSeries::const_iterator::operator++() {
+    Position_++;
+    if (Block_ < Series_->SealedCount() && Position_ == Series_->Sealed_->Blocks[Block_]->Count) {
+        Block_++;
+        Position_ = 0;
+    }
+    Load();
+    return *this;
+}
+
+void TColumnarSeries::const_iterator::Load() {
+    if (Block_ < Series_->SealedCount()) {
+        if (!Decoded_ || DecodedBlock_ != Block_) {
+            Decoded_ = Block_ == 0
+                ? Series_->Head_
+                : std::make_shared<const std::vector<TReading>>(Series_->Sealed_->Blocks[Block_]->Decode());
+            DecodedBlock_ = Block_;
+        }
+        Current_ = (*Decoded_)[Position_];
+    } else if (Position_ < Series_->OpenCount()) {
+        Current_ = {
+            FromMilliseconds(Series_->Open_->TimestampsMs[Position_]),
+            Series_->Open_->Values[Position_]
+        };
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TReading TColumnarSeries::front() const {
+    if (SealedCount() > 0) {
+        return (*Head_)[Offset_];
+    }
+    return {FromMilliseconds(Open_->TimestampsMs[Offset_]), Open_->Values[Offset_]};
+}
+
+TReading TColumnarSeries::back() const {
+    if (OpenCount() > 0) {
+        return {FromMilliseconds(Open_->TimestampsMs.back()), Open_->Values.back()};
+    }
+    const auto& block = Sealed_->Blocks.back();
+    return {FromMilliseconds(block->LastTimestampMs), block->LastValue};
+}
+
+TColumnarSeries::const_iterator TColumnarSeries::begin() const {
+    return Size_ == 0 ? end() : const_iterator(this, 0, Offset_);
+}
+
+TColumnarSeries::const_iterator TColumnarSeries::end() const {
+    return const_iterator(this, SealedCount(), OpenCount());
+}
+
+TColumnarSeries::const_iterator TColumnarSeries::LowerBound(std::chrono::system_clock::time_point timestamp) const {
+    if (Size_ == 0) {
+        return end();
+    }
+
+    const int64_t timestampMs = CeilMilliseconds(timestamp);
+    const size_t sealed = SealedCount();
+
+    if (sealed > 0) {
+        const auto& blocks = Sealed_->Blocks;
+        auto block = std::partition_point(blocks.begin(), blocks.end(), [&] (const TSealedBlockPtr& block) {
+            return block->LastTimestampMs < timestampMs;
+        });
+
+        if (block != blocks.end()) {
+            size_t index = block - blocks.begin();
+            auto decoded = index == 0 ? Head_ : std::make_shared<const std::vector<TReading>>((*block)->Decode());
+            const auto& readings = *decoded;
+            auto first = readings.begin() + (index == 0 ? Offset_ : 0);
+            auto position = std::partition_point(first, readings.end(), [&] (const TReading& reading) {
+                return ToMilliseconds(reading.timestamp) < timestampMs;
+            });
+            if (position != readings.end()) {
+                return const_iterator(this, index, position - readings.begin());
+            }
+        }
+    }
+
+    if (OpenCount() == 0) {
+        return end();
+    }
+
+    const auto& timestamps = Open_->TimestampsMs;
+    auto first = timestamps.begin() + (sealed == 0 ? Offset_ : 0);
+    auto position = std::lower_bound(first, timestamps.end(), timestampMs);
+    return const_iterator(this, sealed, position - timestamps.begin());
+}
+
+TColumnarSeries::const_iterator TColumnarSeries::At(size_t index) const {
+    if (index >= Size_) {
+        return end();
+    }
+    size_t position = index + Offset_;
+    return const_iterator(this, position / BlockSize, position % BlockSize);
+}
+
+size_t TColumnarSeries::IndexOf(const const_iterator& iterator) const {
+    return iterator.Block_ * BlockSize + iterator.Position_ - Offset_;
+}
+
+TColumnarSeries TColumnarSeries::Slice(size_t first, size_t last) const {
+    TColumnarSeries result;
+    last = std::min(last, Size_);
+    auto iter = At(first);
+    for (size_t index = first; index < last; index++, ++iter) {
+        result.push_back(*iter);
+    }
+    return result;
+}
+
+void TColumnarSeries::push_back(const TReading& reading) {
+    if (!Open_) {
+        Open_ = NCommon::New<TOpenBlock>();
+        Open_->TimestampsMs.reserve(BlockSize);
+        Open_->Values.reserve(BlockSize);
+    } else if (NRefCounted::GetRefCount(&*Open_) > 1) {
+        auto open = NCommon::New<TOpenBlock>();
+        open->TimestampsMs.reserve(BlockSize);
+        open->Values.reserve(BlockSize);
+        open->TimestampsMs = Open_->TimestampsMs;
+        open->Values = Open_->Values;
+        Open_ = std::move(open);
+    }
+
+    Open_->TimestampsMs.push_back(ToMilliseconds(reading.timestamp));
+    Open_->Values.push_back(reading.temperature);
+    Size_++;
+
+    if (Open_->TimestampsMs.size() == BlockSize) {
+        Seal();
+    }
+}
+
+void TColumnarSeries::pop_front() {
+    Offset_++;
+    Size_--;
+
+    if (Size_ == 0) {
+        clear();
+    } else if (SealedCount() > 0 && Offset_ == Sealed_->Blocks.front()->Count) {
+        DropFirstBlocks(1);
+    }
+}
+
+void TColumnarSeries::DropBefore(std::chrono::system_clock::time_point timestamp) {
+    const int64_t timestampMs = CeilMilliseconds(timestamp);
+
+    // Whole blocks go by their last timestamp, without decoding
+    if (SealedCount() > 0) {
+        const auto& blocks = Sealed_->Blocks;
+        auto alive = std::partition_point(blocks.begin(), blocks.end(), [&] (const TSealedBlockPtr& block) {
+            return block->LastTimestampMs < timestampMs;
+        });
+        size_t expired = alive - blocks.begin();
+        if (expired > 0) {
+            size_t count = 0;
+            for (auto block = blocks.begin(); block != alive; ++block) {
+                count += (*block)->Count;
+            }
+            Size_ -= count - Offset_;
+            DropFirstBlocks(expired);
+        }
+    }
+
+    size_t dropped = 0;
+    if (SealedCount() > 0) {
+        const auto& readings = *Head_;
+        for (size_t i = Offset_; i < readings.size() && ToMilliseconds(readings[i].timestamp) < timestampMs; i++) {
+            dropped++;
+        }
+    } else if (OpenCount() > 0) {
+        const auto& timestamps = Open_->TimestampsMs;
+        for (size_t i = Offset_; i < timestamps.size() && timestamps[i] < timestampMs; i++) {
+            dropped++;
+        }
+    }
+
+    Offset_ += dropped;
+    Size_ -= dropped;
+
+    if (Size_ == 0) {
+        clear();
+    } else if (SealedCount() > 0 && Offset_ == Sealed_->Blocks.front()->Count) {
+        DropFirstBlocks(1);
+    }
+}
+
+void TColumnarSeries::clear() {
+    Sealed_.reset();
+    Open_.reset();
+    Head_.reset();
+    Offset_ = 0;
+    Size_ = 0;
+}
+
+size_t TColumnarSeries::GetMemoryUsage() const {
+    size_t usage = sizeof(*this);
+    if (Sealed_) {
+        usage += sizeof(TSpine) + Sealed_->Blocks.capacity() * sizeof(TSealedBlockPtr);
+        for (const auto& block : Sealed_->Blocks) {
+            usage += sizeof(TSealedBlock) + block->Data.capacity() * sizeof(uint64_t);
+        }
+    }
+    if (Open_) {
+        usage += sizeof(TOpenBlock)
+            + Open_->TimestampsMs.capacity() * sizeof(int64_t)
+            + Open_->Values.capacity() * sizeof(double);
+    }
+    if (Head_) {
+        usage += Head_->capacity() * sizeof(TReading);
+    }
+    return usage;
+}
+
+size_t TColumnarSeries::SealedCount() const {
+    return Sealed_ ? Sealed_->Blocks.size() : 0;
+}
+
+size_t TColumnarSeries::OpenCount() const {
+    return Open_ ? Open_->TimestampsMs.size() : 0;
+}
+
+void TColumnarSeries::Seal() {
+    TGorillaEncoder encoder;
+    for (size_t i = 0; i < Open_->TimestampsMs.size(); i++) {
+        encoder.Append(Open_->TimestampsMs[i], Open_->Values[i]);
+    }
+
+    auto block = NCommon::New<TSealedBlock>();
+    block->FirstTimestampMs = Open_->TimestampsMs.front();
+    block->LastTimestampMs = Open_->TimestampsMs.back();
+    block->LastValue = Open_->Values.back();
+    block->Count = encoder.GetCount();
+    block->Data = encoder.Finish();
+
+    if (SealedCount() == 0) {
+        std::vector<TReading> head;
+        head.reserve(Open_->TimestampsMs.size());
+        for (size_t i = 0; i < Open_->TimestampsMs.size(); i++) {
+            head.push_back({FromMilliseconds(Open_->TimestampsMs[i]), Open_->Values[i]});
+        }
+        Head_ = std::make_shared<const std::vector<TReading>>(std::move(head));
+    }
+
+    MutableSpine().push_back(std::move(block));
+    Open_.reset();
+}
+
+void TColumnarSeries::DropFirstBlocks(size_t count) {
+    auto& blocks = MutableSpine();
+    blocks.erase(blocks.begin(), blocks.begin() + count);
+    Offset_ = 0;
+
+    Head_.reset();
+    if (!blocks.empty()) {
+        Head_ = std::make_shared<const std::vector<TReading>>(blocks.front()->Decode());
+    }
+}
+
+std::vector<TColumnarSeries::TSealedBlockPtr>& TColumnarSeries::MutableSpine() {
+    if (!Sealed_) {
+        Sealed_ = NCommon::New<TSpine>();
+    } else if (NRefCounted::GetRefCount(&*Sealed_) > 1) {
+        auto spine = NCommon::New<TSpine>();
+        spine->Blocks = Sealed_->Blocks;
+        Sealed_ = std::move(spine);
+    }
+    return Sealed_->Blocks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
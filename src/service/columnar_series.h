@@ -0,0 +1,162 @@
+#pragma once
+
+#include <service/reading.h>
+
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Compressed series of readings with millisecond timestamps.
+//! Readings are kept in blocks of `BlockSize`: the open block stores
+//! timestamps and values in separate arrays, full blocks are sealed with
+//! Gorilla encoding (delta-of-delta timestamps, XOR-encoded values).
+//! Like TChunkedSeries, copies share blocks and a mutation copies only the
+//! open block or the block spine when they are shared with other copies.
+//! The first sealed block is kept decoded, so front() and drops from the
+//! front decode a block only once it becomes the first one.
+class TColumnarSeries {
+public:
+    static constexpr size_t BlockSize = 256;
+
+private:
+    struct TSealedBlock
+        : public NRefCounted::TRefCountedBase
+    {
+        int64_t FirstTimestampMs;
+        int64_t LastTimestampMs;
+        double LastValue;
+        size_t Count;
+        std::vector<uint64_t> Data;
+
+        std::vector<TReading> Decode() const;
+    };
+
+    using TSealedBlockPtr = NCommon::TIntrusivePtr<TSealedBlock>;
+
+    struct TOpenBlock
+        : public NRefCounted::TRefCountedBase
+    {
+        std::vector<int64_t> TimestampsMs;
+        std::vector<double> Values;
+    };
+
+    using TOpenBlockPtr = NCommon::TIntrusivePtr<TOpenBlock>;
+
+    struct TSpine
+        : public NRefCounted::TRefCountedBase
+    {
+        std::vector<TSealedBlockPtr> Blocks;
+    };
+
+    using TSpinePtr = NCommon::TIntrusivePtr<TSpine>;
+
+public:
+    using value_type = TReading;
+    using size_type = size_t;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TReading;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TReading*;
+        using reference = const TReading&;
+
+        const_iterator() = default;
+        const_iterator(const TColumnarSeries* series, size_t block, size_t position);
+
+        reference operator*() const { return Current_; }
+        pointer operator->() const { return &Current_; }
+
+        const_iterator& operator++();
+        const_iterator operator++(int) { auto copy = *this; ++*this; return copy; }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+            return lhs.Block_ == rhs.Block_ && lhs.Position_ == rhs.Position_;
+        }
+
+    private:
+        friend class TColumnarSeries;
+
+        void Load();
+
+        const TColumnarSeries* Series_ = nullptr;
+        size_t Block_ = 0;
+        size_t Position_ = 0;
+
+        std::shared_ptr<const std::vector<TReading>> Decoded_;
+        size_t DecodedBlock_ = 0;
+
+        TReading Current_{};
+    };
+
+    using iterator = const_iterator;
+
+    TColumnarSeries() = default;
+
+    size_t size() const { return Size_; }
+    bool empty() const { return Size_ == 0; }
+
+    TReading front() const;
+    TReading back() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    //! Returns the first reading not older than `timestamp`.
+    const_iterator LowerBound(std::chrono::system_clock::time_point timestamp) const;
+
+    //! Every block but the open one holds exactly `BlockSize` readings, so
+    //! positions map to iterators without decoding.
+    const_iterator At(size_t index) const;
+    size_t IndexOf(const const_iterator& iterator) const;
+
+    //! Copies readings [first, last) into a new series.
+    TColumnarSeries Slice(size_t first, size_t last) const;
+
+    void push_back(const TReading& reading);
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        push_back(TReading(std::forward<Args>(args)...));
+    }
+
+    void pop_front();
+
+    //! Drops all readings older than `timestamp` from the front.
+    void DropBefore(std::chrono::system_clock::time_point timestamp);
+
+    void clear();
+
+    //! Approximate heap footprint, shared blocks are counted in full.
+    size_t GetMemoryUsage() const;
+
+private:
+    size_t SealedCount() const;
+    size_t OpenCount() const;
+
+    void Seal();
+    void DropFirstBlocks(size_t count);
+    std::vector<TSealedBlockPtr>& MutableSpine();
+
+    TSpinePtr Sealed_;
+    TOpenBlockPtr Open_;
+
+    //! Readings of the first sealed block, set whenever there is one.
+    std::shared_ptr<const std::vector<TReading>> Head_;
+
+    //! Number of dropped readings at the beginning of the first block.
+    size_t Offset_ = 0;
+    size_t Size_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
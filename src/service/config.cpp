@@ -14,22 +14,114 @@ void TSimulatorConfig::Load(const nlohmann::json& data) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+ERawLayout ParseRawLayout(const std::string& layout) {
+    if (layout == "segments") return ERawLayout::Segments;
+    if (layout == "ring") return ERawLayout::Ring;
+    THROW("Unknown raw layout '{}', expected 'segments' or 'ring'", layout);
+}
+
+EFileFormat ParseFileFormat(const std::string& format) {
+    if (format == "text") return EFileFormat::Text;
+    if (format == "binary") return EFileFormat::Binary;
+    THROW("Unknown file format '{}', expected 'text' or 'binary'", format);
+}
+
+EValueEncoding ParseValueEncoding(const std::string& encoding) {
+    if (encoding == "double") return EValueEncoding::Double;
+    if (encoding == "float") return EValueEncoding::Float;
+    if (encoding == "fixed_point") return EValueEncoding::FixedPoint;
+    THROW("Unknown value encoding '{}', expected 'double', 'float' or 'fixed_point'", encoding);
+}
+
+EDurability ParseDurability(const std::string& durability) {
+    if (durability == "none") return EDurability::None;
+    if (durability == "interval") return EDurability::Interval;
+    if (durability == "records") return EDurability::Records;
+    THROW("Unknown durability '{}', expected 'none', 'interval' or 'records'", durability);
+}
+
 void TFileStorageConfig::Load(const nlohmann::json& data) {
     TemperaturePath = TConfigBase::LoadRequired<std::string>(data, "temperature");
     TemperatureHourPath = TConfigBase::LoadRequired<std::string>(data, "hourly");
     TemperatureDayPath = TConfigBase::LoadRequired<std::string>(data, "daily");
+    RollupStatePath = TConfigBase::Load<std::string>(data, "rollup_state", "");
+    if (RollupStatePath.empty()) {
+        RollupStatePath = TemperatureHourPath.parent_path() / "rollup_state.json";
+    }
+    PyramidStatePath = TConfigBase::Load<std::string>(data, "pyramid_state", "");
+    if (PyramidStatePath.empty()) {
+        PyramidStatePath = TemperatureHourPath.parent_path() / "pyramid.bin";
+    }
+
+    Format.File = ParseFileFormat(TConfigBase::Load<std::string>(data, "format", "text"));
+    Format.Value = ParseValueEncoding(TConfigBase::Load<std::string>(data, "value_encoding", "float"));
+    RawLayout = ParseRawLayout(TConfigBase::Load<std::string>(data, "raw_layout", "segments"));
+    SegmentDuration = std::chrono::minutes(TConfigBase::Load<uint32_t>(data, "segment_minutes", 60));
+    RingCapacity = TConfigBase::Load<uint64_t>(data, "ring_capacity", 1ull << 20);
+
+    Durability.Mode = ParseDurability(TConfigBase::Load<std::string>(data, "durability", "none"));
+    Durability.SyncInterval = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "sync_interval_ms", 1000));
+    Durability.SyncRecords = TConfigBase::Load<uint64_t>(data, "sync_records", 100);
+    ASSERT(Durability.SyncRecords > 0, "sync_records must be positive");
+
+    RetentionInterval = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "retention_interval_ms", 60000));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ESqliteSynchronous ParseSqliteSynchronous(const std::string& synchronous) {
+    if (synchronous == "off") return ESqliteSynchronous::Off;
+    if (synchronous == "normal") return ESqliteSynchronous::Normal;
+    if (synchronous == "full") return ESqliteSynchronous::Full;
+    THROW("Unknown synchronous mode '{}', expected 'off', 'normal' or 'full'", synchronous);
+}
+
+void TSqliteStorageConfig::Load(const nlohmann::json& data) {
+    Path = TConfigBase::LoadRequired<std::string>(data, "path");
+    Synchronous = ParseSqliteSynchronous(TConfigBase::Load<std::string>(data, "synchronous", "normal"));
+    BusyTimeout = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "busy_timeout_ms", 5000));
+
+    MaxBatchSize = TConfigBase::Load<uint32_t>(data, "max_batch_size", 1);
+    MaxBatchLatency = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "max_batch_latency_ms", 1000));
+    RetryBufferSize = TConfigBase::Load<uint32_t>(data, "retry_buffer_size", 100000);
+
+    RetentionInterval = std::chrono::milliseconds(TConfigBase::Load<uint32_t>(data, "retention_interval_ms", 60000));
+    RetentionBatchSize = TConfigBase::Load<uint32_t>(data, "retention_batch_size", 10000);
+    ASSERT(RetentionBatchSize > 0, "retention_batch_size must be positive");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+EOverflowPolicy ParseOverflowPolicy(const std::string& policy) {
+    if (policy == "block") return EOverflowPolicy::Block;
+    if (policy == "drop_oldest") return EOverflowPolicy::DropOldest;
+    if (policy == "coalesce") return EOverflowPolicy::Coalesce;
+    THROW("Unknown overflow policy '{}', expected 'block', 'drop_oldest' or 'coalesce'", policy);
+}
+
+void TAsyncWriterConfig::Load(const nlohmann::json& data) {
+    QueueSize = TConfigBase::Load<size_t>(data, "queue_size", 10000);
+    ASSERT(QueueSize > 0, "queue_size must be positive");
+    Overflow = ParseOverflowPolicy(TConfigBase::Load<std::string>(data, "overflow", "block"));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void TStorageConfig::Load(const nlohmann::json& data) {
-    ASSERT(!data.contains("file_system") || !data.contains("db_client"), "Config must contain only one system of storage data");
-    ASSERT(data.contains("file_system") || data.contains("db_client"), "Config must contain file_system or db_client config");
+    const int backends = data.contains("file_system") + data.contains("db_client") + data.contains("sqlite");
+    ASSERT(backends <= 1, "Config must contain only one system of storage data");
+    ASSERT(backends == 1, "Config must contain file_system, db_client or sqlite config");
 
     if (data.contains("file_system")) {
         FileStorageConfig = TConfigBase::LoadRequired<NConfig::TFileStorageConfig>(data, "file_system");
     } else if (data.contains("db_client")) {
         DataBaseConfig = TConfigBase::LoadRequired<NIpc::TDataBaseConfig>(data, "db_client");
+    } else if (data.contains("sqlite")) {
+        SqliteStorageConfig = TConfigBase::LoadRequired<TSqliteStorageConfig>(data, "sqlite");
+    }
+
+    if (data.contains("async_writer")) {
+        AsyncWriterConfig = TConfigBase::LoadRequired<TAsyncWriterConfig>(data, "async_writer");
     }
 }
 
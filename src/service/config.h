@@ -27,12 +27,67 @@ DECLARE_REFCOUNTED(TSimulatorConfig);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+enum class ERawLayout {
+    Segments,
+    Ring,
+};
+
+ERawLayout ParseRawLayout(const std::string& layout);
+
+enum class EFileFormat {
+    Text,
+    Binary,
+};
+
+EFileFormat ParseFileFormat(const std::string& format);
+
+enum class EValueEncoding {
+    Double,
+    Float,
+    FixedPoint,
+};
+
+EValueEncoding ParseValueEncoding(const std::string& encoding);
+
+//! When the flusher forces written data to disk with fdatasync.
+enum class EDurability {
+    None,
+    Interval,
+    Records,
+};
+
+EDurability ParseDurability(const std::string& durability);
+
+struct TDurabilityPolicy {
+    EDurability Mode = EDurability::None;
+    std::chrono::milliseconds SyncInterval{1000};
+    uint64_t SyncRecords = 100;
+};
+
+//! How readings are written to files, reading detects the format itself.
+struct TReadingsFormat {
+    EFileFormat File = EFileFormat::Text;
+    EValueEncoding Value = EValueEncoding::Float;
+};
+
 struct TFileStorageConfig
     : public NCommon::TConfigBase
 {
     std::filesystem::path TemperaturePath;
     std::filesystem::path TemperatureHourPath;
     std::filesystem::path TemperatureDayPath;
+    std::filesystem::path RollupStatePath;
+    std::filesystem::path PyramidStatePath;
+
+    TReadingsFormat Format;
+    ERawLayout RawLayout;
+    std::chrono::minutes SegmentDuration;
+    uint64_t RingCapacity;
+
+    TDurabilityPolicy Durability;
+
+    //! How often the janitor removes expired readings.
+    std::chrono::milliseconds RetentionInterval;
 
     void Load(const nlohmann::json& data) override;
 };
@@ -41,11 +96,77 @@ DECLARE_REFCOUNTED(TFileStorageConfig);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+//! How often SQLite syncs the WAL: `off`, `normal` (at checkpoints) or
+//! `full` (at every commit).
+enum class ESqliteSynchronous {
+    Off,
+    Normal,
+    Full,
+};
+
+ESqliteSynchronous ParseSqliteSynchronous(const std::string& synchronous);
+
+struct TSqliteStorageConfig
+    : public NCommon::TConfigBase
+{
+    std::filesystem::path Path;
+    ESqliteSynchronous Synchronous;
+
+    //! How long a write waits for a lock held by another connection.
+    std::chrono::milliseconds BusyTimeout;
+
+    //! Readings per transaction, one disables batching.
+    uint32_t MaxBatchSize;
+    std::chrono::milliseconds MaxBatchLatency;
+
+    //! Readings of failed transactions kept to be written with the next one.
+    uint32_t RetryBufferSize;
+
+    //! Expired rows are deleted by a janitor, at most a batch per statement.
+    std::chrono::milliseconds RetentionInterval;
+    uint32_t RetentionBatchSize;
+
+    void Load(const nlohmann::json& data) override;
+};
+
+DECLARE_REFCOUNTED(TSqliteStorageConfig);
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! What the async writer does with a reading when its queue is full.
+enum class EOverflowPolicy {
+    //! Wait for the writer to free a slot.
+    Block,
+    //! Discard the oldest queued reading.
+    DropOldest,
+    //! Fold the reading into the newest queued one, which keeps the mean.
+    Coalesce,
+};
+
+EOverflowPolicy ParseOverflowPolicy(const std::string& policy);
+
+struct TAsyncWriterConfig
+    : public NCommon::TConfigBase
+{
+    size_t QueueSize;
+    EOverflowPolicy Overflow;
+
+    void Load(const nlohmann::json& data) override;
+};
+
+DECLARE_REFCOUNTED(TAsyncWriterConfig);
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct TStorageConfig
     : public NCommon::TConfigBase
 {
     TFileStorageConfigPtr FileStorageConfig;
     NIpc::TDataBaseConfigPtr DataBaseConfig;
+    TSqliteStorageConfigPtr SqliteStorageConfig;
+
+    //! Null when readings are written synchronously.
+    TAsyncWriterConfigPtr AsyncWriterConfig;
     
     void Load(const nlohmann::json& data) override;
 };
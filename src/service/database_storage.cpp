@@ -1,4 +1,8 @@
 #include <service/database_storage.h>
+#include <service/postgres_readings_db.h>
+
+#include <ranges>
+#include <sstream>
 
 namespace NService {
 
@@ -8,6 +12,10 @@ namespace {
 
 inline const std::string LoggingSource = "DataBaseStorage";
 
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace
@@ -15,217 +23,378 @@ inline const std::string LoggingSource = "DataBaseStorage";
 ////////////////////////////////////////////////////////////////////////////////
 
 TDataBaseStorage::TDataBaseStorage(NIpc::TDataBaseConfigPtr config)
+    : TDataBaseStorage(config, std::make_unique<TPostgresReadingsDb>(config))
+{}
+
+TDataBaseStorage::TDataBaseStorage(NIpc::TDataBaseConfigPtr config, std::unique_ptr<TReadingsDbBase> db)
     : Config_(config),
-      Client_(NCommon::New<NIpc::TDbClient>(config))
+      Db_(std::move(db)),
+      SpooledRecords_(NMetrics::GetMetricRegistry().GetGauge("db_storage_spooled_records"))
 {
-    Client_->Connect();
-    auto tx = Client_->BeginTransaction();
-    CreateTables();
-    LoadLastAverages();
+    if (Config_->Follower) {
+        // The writer owns the schema and retention. The cache is loaded once
+        // LISTEN is issued, so no notification falls in between
+        Listener_ = Db_->CreateListener(
+            [this] (const std::string& payload) { ApplyNotification(payload); },
+            [this] { Resync(); });
+        Listener_->Start();
+
+        Janitor_ = std::make_unique<TRetentionJanitor>("db_storage", [this] { return RemoveExpired(); }, Config_->RetentionInterval);
+        Janitor_->Start();
+        return;
+    }
+
+    Db_->CreateSchema(Config_->NotifyFollowers);
     RefreshCache();
-}
 
-void TDataBaseStorage::RefreshCache() {
-    while (true) {
-        try {
-            TCachePtr newCache = NCommon::New<TCache>();
+    if (!Config_->SpoolPath.empty()) {
+        Spool_.emplace(Config_->SpoolPath);
+        SpooledRecords_->Set(Spool_->Size());
+        Replayer_ = std::thread(&TDataBaseStorage::ReplayLoop, this);
+    }
 
-            auto rawResult = Client_->SelectRows("raw_temperatures", "", {"timestamp_ms DESC"});
-            newCache->rawReadings = ConvertTemperature(rawResult);
+    Writer_ = std::make_unique<TBatchWriter>("db_storage", Config_->MaxBatchSize, Config_->MaxBatchLatency,
+        [this] (std::span<const TReading> readings) {
+            auto guard = std::lock_guard(WriteMutex_);
+            IngestBatch(readings);
+        });
+
+    Janitor_ = std::make_unique<TRetentionJanitor>("db_storage", [this] { return RemoveExpired(); }, Config_->RetentionInterval);
+    Janitor_->Start();
+}
 
-            auto hourlyResult = Client_->SelectRows("hourly_averages", "", {"timestamp_ms DESC"});
-            newCache->hourlyAverages = ConvertAverages(hourlyResult);
+TDataBaseStorage::~TDataBaseStorage() {
+    Janitor_.reset();
+    Listener_.reset();
 
-            auto dailyResult = Client_->SelectRows("daily_averages", "", {"timestamp_ms DESC"});
-            newCache->dailyAverages = ConvertAverages(dailyResult);
+    // The writer spools what it fails to write, the spool is replayed on restart
+    Writer_.reset();
 
-            Cache_.Store(newCache);
-            return;
-        } catch (std::exception& ex) {
-            LOG_WARNING("Failed to update cache: {}", ex);
+    if (Replayer_.joinable()) {
+        {
+            auto guard = std::lock_guard(ReplayMutex_);
+            ReplayStopping_ = true;
         }
+        ReplayCondition_.notify_one();
+        Replayer_.join();
     }
 }
 
-void TDataBaseStorage::CreateTables() {
-    Client_->ExecuteQuery(R"(
-        CREATE TABLE IF NOT EXISTS raw_temperatures (
-            timestamp_ms BIGINT PRIMARY KEY,
-            temperature DOUBLE PRECISION NOT NULL
-        )
-    )");
+void TDataBaseStorage::Resync() {
+    auto guard = std::lock_guard(WriteMutex_);
+    LOG_INFO("Reloading cache from the database");
+    RefreshCache();
+}
+
+void TDataBaseStorage::RefreshCache() {
+    try {
+        Cache_.Load(Db_->LoadSnapshot(GetCachedRawMs()));
+        ResyncRequired_ = false;
+    } catch (std::exception& ex) {
+        // The current cache is served until the next write reloads it
+        LOG_WARNING("Failed to update cache: {}", ex);
+        ResyncRequired_ = true;
+    }
+}
+
+void TDataBaseStorage::ApplyNotification(const std::string& payload) {
+    std::vector<TReading> readings;
+    std::istringstream in(payload);
+    int64_t timestampMs;
+    double value;
+    while (in >> timestampMs >> value) {
+        readings.push_back({std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs)), value});
+    }
 
-    Client_->ExecuteQuery(R"(
-        CREATE TABLE IF NOT EXISTS hourly_averages (
-            timestamp_ms BIGINT PRIMARY KEY,
-            avg_temperature DOUBLE PRECISION NOT NULL
-        )
-    )");
+    auto guard = std::lock_guard(WriteMutex_);
+
+    // Rows may already be in the cache if they were loaded by a reload.
+    // A row that is older than the newest cached one but missing from the
+    // cache was inserted out of order, only a reload places it and updates
+    // the rollups it falls in
+    TCachePtr currentCache = Cache_.Acquire();
+    const auto& raw = currentCache->rawReadings;
+    std::vector<TReading> newer;
+    bool missing = false;
+    for (const auto& reading : readings) {
+        const bool isNewer = newer.empty()
+            ? raw.empty() || reading.timestamp > raw.back().timestamp
+            : reading.timestamp > newer.back().timestamp;
+        if (isNewer) {
+            newer.push_back(reading);
+            Cache_.AddToPyramid(reading);
+        } else {
+            auto found = raw.LowerBound(reading.timestamp);
+            missing |= found == raw.end() || found->timestamp != reading.timestamp;
+        }
+    }
 
-    Client_->ExecuteQuery(R"(
-        CREATE TABLE IF NOT EXISTS daily_averages (
-            timestamp_ms BIGINT PRIMARY KEY,
-            avg_temperature DOUBLE PRECISION NOT NULL
-        )
-    )");
+    if (missing || ResyncRequired_ || !Cache_.Append(newer)) {
+        LOG_INFO("Reloading cache from the database");
+        RefreshCache();
+    }
 }
 
 void TDataBaseStorage::ProcessTemperature(const TReading& reading) {
-    try {
-        auto tx = Client_->BeginTransaction();
+    if (Config_->Follower) {
+        LOG_WARNING("Follower does not ingest readings, dropped a reading");
+        return;
+    }
 
-        const int64_t tsMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-            reading.timestamp.time_since_epoch()
-        ).count();
+    Writer_->Add(reading);
+}
 
-        InsertRawReading(tsMs, reading.temperature);
-        
-        Client_->DeleteRow("raw_temperatures", 
-            NCommon::Format("timestamp_ms < {}", tsMs - 86400 * 1000));
+void TDataBaseStorage::IngestBatch(std::span<const TReading> readings) {
+    // Queued behind the spool until it is replayed, so rows and averages are
+    // written in order and ingestion does not wait for a dead connection
+    if (Spool_ && !Spool_->Empty()) {
+        SpoolReadings(readings);
+        return;
+    }
 
-        ProcessHourlyAverage(tsMs);
-        
-        ProcessDailyAverage(tsMs);
+    if (!WriteReadings(readings, false)) {
+        if (Spool_) {
+            SpoolReadings(readings);
+        } else {
+            LOG_ERROR("Dropped {} readings", readings.size());
+        }
+    }
+}
 
+bool TDataBaseStorage::WriteReadings(std::span<const TReading> readings, bool replay) {
+    std::vector<TReading> written;
+    std::span<const TReading> inserted = readings;
+    try {
+        if (readings.size() == 1 && !replay) {
+            Db_->IngestReading(readings.front());
+        } else {
+            // A replayed batch may have been committed before its outcome
+            // was lost, rows that are already there are kept
+            auto tx = Db_->BeginTransaction();
+            written = tx->WriteReadings(readings, replay);
+            tx->Commit();
+            inserted = written;
+        }
+    } catch (std::exception& ex) {
+        LOG_ERROR("Failed to process {} readings: {}", readings.size(), ex);
+        // The commit outcome is unknown if the connection broke during it
+        ResyncRequired_ = true;
+        return false;
+    }
+
+    // Kept rows are already counted
+    for (const auto& reading : inserted) {
+        Cache_.AddToPyramid(reading);
+    }
+
+    // Skipped replayed rows are not counted by the database rollups,
+    // so only readings newer than every cached one are applied here
+    if (ResyncRequired_ || !Cache_.Append(readings)) {
+        LOG_INFO("Reloading cache from the database");
         RefreshCache();
+    }
+    return true;
+}
 
-        tx.Commit();
+void TDataBaseStorage::SpoolReadings(std::span<const TReading> readings) {
+    try {
+        Spool_->Append(readings);
     } catch (std::exception& ex) {
-        LOG_ERROR("Failed to process temperature: {}", ex);
-    }
-}
-
-void TDataBaseStorage::InsertRawReading(int64_t tsMs, double temp) {
-    Client_->InsertRow("raw_temperatures", {
-        {"timestamp_ms", std::to_string(tsMs)},
-        {"temperature", std::to_string(temp)}
-    });
-}
-
-void TDataBaseStorage::ProcessHourlyAverage(int64_t currentTs) {
-    const int64_t oneHour = 3600ll * 1000ll;
-    const int64_t monthAgo = currentTs - 30ll * 86400ll * 1000ll;
-
-    if (!LastHourly_ || (currentTs - LastHourly_->TimestampMs) >= oneHour) {
-        auto result = Client_->ExecuteQuery(
-            "INSERT INTO hourly_averages (timestamp_ms, avg_temperature) "
-            "SELECT "
-            "   MAX(timestamp_ms) AS timestamp_ms, "
-            "   AVG(temperature) AS avg_temperature "
-            "FROM ("
-            "   SELECT "
-            "       timestamp_ms, "
-            "       temperature "
-            "   FROM raw_temperatures "
-            "   WHERE timestamp_ms BETWEEN $1 AND $2"
-            ") as raw",
-            currentTs - oneHour,
-            currentTs
-        );
-
-        if (result.affected_rows() > 0) {
-            auto lastResult = Client_->SelectRows("hourly_averages", 
-                "", {"timestamp_ms DESC"}, 1);
-            LastHourly_ = {
-                lastResult[0]["timestamp_ms"].as<int64_t>(),
-                lastResult[0]["avg_temperature"].as<double>()
-            };
-        }
+        LOG_ERROR("Dropped {} readings, failed to spool them: {}", readings.size(), ex);
+        return;
     }
+    SpooledRecords_->Set(Spool_->Size());
 
-    Client_->DeleteRow("hourly_averages", 
-        NCommon::Format("timestamp_ms < {}", monthAgo));
-}
-
-void TDataBaseStorage::ProcessDailyAverage(int64_t currentTs) {
-    const int64_t oneDay = 86400ll * 1000ll;
-    const int64_t yearAgo = currentTs - 365ll * 86400ll * 1000ll;
-
-    if (!LastDaily_ || (currentTs - LastDaily_->TimestampMs) >= oneDay) {
-        auto result = Client_->ExecuteQuery(
-            "INSERT INTO daily_averages (timestamp_ms, avg_temperature) "
-            "SELECT "
-            "   MAX(timestamp_ms) AS timestamp_ms, "
-            "   AVG(avg_temperature) AS avg_temperature "
-            "FROM ("
-            "   SELECT "
-            "       timestamp_ms, "
-            "       avg_temperature "
-            "   FROM hourly_averages "
-            "   WHERE timestamp_ms BETWEEN $1 AND $2"
-            ") as hourly",
-            currentTs - oneDay,
-            currentTs
-        );
-
-        if (result.affected_rows() > 0) {
-            auto lastResult = Client_->SelectRows("daily_averages", 
-                "", {"timestamp_ms DESC"}, 1);
-            LastDaily_ = {
-                lastResult[0]["timestamp_ms"].as<int64_t>(),
-                lastResult[0]["avg_temperature"].as<double>()
-            };
-        }
+    // Taken so the notification cannot slip in before the replayer waits
+    {
+        auto guard = std::lock_guard(ReplayMutex_);
     }
-
-    Client_->DeleteRow("daily_averages", 
-        NCommon::Format("timestamp_ms < {}", yearAgo));
+    ReplayCondition_.notify_one();
 }
 
-void TDataBaseStorage::LoadLastAverages() {
-    auto getLast = [&](const std::string& table) -> std::optional<AverageRecord> {
-        auto result = Client_->SelectRows(table, "", {"timestamp_ms DESC"}, 1);
-        if (!result.empty()) {
-            return AverageRecord{
-                result[0]["timestamp_ms"].as<int64_t>(),
-                result[0]["avg_temperature"].as<double>()
-            };
+void TDataBaseStorage::ReplayLoop() {
+    auto lock = std::unique_lock(ReplayMutex_);
+
+    while (true) {
+        ReplayCondition_.wait(lock, [&] { return ReplayStopping_ || !Spool_->Empty(); });
+        if (ReplayStopping_) {
+            break;
         }
-        return std::nullopt;
-    };
+        lock.unlock();
+
+        bool replayed = ReplaySpool();
 
-    LastHourly_ = getLast("hourly_averages");
-    LastDaily_ = getLast("daily_averages");
+        lock.lock();
+        if (!replayed) {
+            ReplayCondition_.wait_for(lock, Config_->SpoolRetryInterval, [&] { return ReplayStopping_; });
+        }
+    }
 }
 
-std::deque<TReading> TDataBaseStorage::ConvertTemperature(const pqxx::result& result) {
-    std::deque<TReading> readings;
-    for (const auto& row : result) {
-        readings.push_back({
-            std::chrono::system_clock::time_point(
-                std::chrono::milliseconds(row["timestamp_ms"].as<int64_t>())
-            ),
-                row["temperature"].as<double>()
-        });
+bool TDataBaseStorage::ReplaySpool() {
+    TReadingSeries readings;
+    try {
+        readings = Spool_->TakeReplay();
+    } catch (std::exception& ex) {
+        LOG_ERROR("Failed to read the spool: {}", ex);
+        return false;
     }
-    return readings;
+
+    LOG_INFO("Replaying {} spooled readings", readings.size());
+    const size_t batchSize = Config_->SpoolReplayBatchSize;
+    for (size_t first = 0; first < readings.size(); first += batchSize) {
+        auto slice = readings.Slice(first, std::min(first + batchSize, readings.size()));
+        std::vector<TReading> batch(slice.begin(), slice.end());
+
+        {
+            auto guard = std::lock_guard(ReplayMutex_);
+            if (ReplayStopping_) {
+                return false;
+            }
+        }
+
+        // The writer goes on spooling between the batches
+        auto guard = std::lock_guard(WriteMutex_);
+        if (!WriteReadings(batch, true)) {
+            return false;
+        }
+    }
+
+    auto guard = std::lock_guard(WriteMutex_);
+    Spool_->CommitReplay();
+    SpooledRecords_->Set(Spool_->Size());
+    LOG_INFO("Replayed {} spooled readings", readings.size());
+    return true;
 }
 
-std::deque<TReading> TDataBaseStorage::ConvertAverages(const pqxx::result& result) {
-    std::deque<TReading> readings;
-    for (const auto& row : result) {
-        readings.push_back({
-            std::chrono::system_clock::time_point(
-                std::chrono::milliseconds(row["timestamp_ms"].as<int64_t>())
-            ),
-            row["avg_temperature"].as<double>()
-        });
+size_t TDataBaseStorage::RemoveExpired() {
+    std::optional<int64_t> newestMs;
+    {
+        auto guard = std::lock_guard(WriteMutex_);
+        newestMs = Cache_.Trim(GetCachedRawMs());
+    }
+
+    if (Config_->Follower) {
+        return 0;
     }
-    return readings;
+    return Db_->RemoveExpired(newestMs);
 }
 
-const std::deque<TReading>& TDataBaseStorage::GetRawReadings() {
+TReadingSeries TDataBaseStorage::GetRawReadings() {
     return Cache_.Acquire()->rawReadings;
 }
 
-const std::deque<TReading>& TDataBaseStorage::GetHourlyAverage() {
+TReadingSeries TDataBaseStorage::GetHourlyAverage() {
     return Cache_.Acquire()->hourlyAverages;
 }
 
-const std::deque<TReading>& TDataBaseStorage::GetDailyAverage() {
+TReadingSeries TDataBaseStorage::GetDailyAverage() {
     return Cache_.Acquire()->dailyAverages;
 }
 
+TReadingSeries TDataBaseStorage::GetRange(
+    EReadingsTier tier,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t limit)
+{
+    auto cache = Cache_.Acquire();
+    const auto& series = GetTier(*cache, tier);
+    if (!Config_->Pushdown || tier != EReadingsTier::Raw || series.empty()) {
+        return SelectRange(series, from, to, limit);
+    }
+
+    // The cache holds every row of the hot window
+    const auto hotFrom = series.back().timestamp - Config_->HotWindow;
+    if (from >= hotFrom) {
+        return SelectRange(series, from, to, limit);
+    }
+    auto hot = SelectRange(series, hotFrom, to, limit);
+    if (hot.size() == limit) {
+        return hot;
+    }
+    return Db_->QueryRawRange(ToMilliseconds(from), ToMilliseconds(to), limit);
+}
+
+std::optional<TPyramidSlice> TDataBaseStorage::GetAggregates(
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t minPoints)
+{
+    if (Config_->Pushdown) {
+        return QueryAggregates(from, to, minPoints);
+    }
+    return Cache_.Acquire()->pyramid.Query(from, to, minPoints);
+}
+
+int64_t TDataBaseStorage::GetCachedRawMs() const {
+    return Config_->Pushdown ? Config_->HotWindow.count() : RawRetentionMs;
+}
+
+std::optional<TPyramidSlice> TDataBaseStorage::QueryAggregates(
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t minPoints)
+{
+    auto bounds = Db_->GetRawBounds();
+    if (!bounds) {
+        return std::nullopt;
+    }
+    const auto [oldestMs, newestMs] = *bounds;
+    const int64_t fromMs = std::max(ToMilliseconds(from), newestMs - DailyRetentionMs);
+    const int64_t toMs = std::min(ToMilliseconds(to), newestMs + 1);
+    if (fromMs >= toMs) {
+        return std::nullopt;
+    }
+
+    // Every raw row since `rawFromMs` is there, older ones only in the rollups
+    const int64_t rawFromMs = std::max(oldestMs, newestMs - RawRetentionMs);
+    auto coveredFromMs = [&] (int64_t resolutionMs) {
+        if (resolutionMs % DayMs == 0) {
+            return newestMs - DailyRetentionMs;
+        }
+        if (resolutionMs % HourMs == 0) {
+            return std::min(rawFromMs, newestMs - HourlyRetentionMs);
+        }
+        return rawFromMs;
+    };
+
+    // Same choice of resolution as TPyramid::Query
+    std::optional<int64_t> resolutionMs;
+    bool enough = false;
+    for (const auto& level : TPyramid::GetDefaultLevels() | std::views::reverse) {
+        const int64_t levelMs = level.Resolution.count();
+        if (resolutionMs && fromMs < coveredFromMs(levelMs)) {
+            break;
+        }
+        resolutionMs = levelMs;
+        if (static_cast<size_t>((toMs - 1) / levelMs - fromMs / levelMs + 1) >= minPoints) {
+            enough = true;
+            break;
+        }
+    }
+    if (!enough && fromMs >= rawFromMs) {
+        return std::nullopt;
+    }
+
+    // Whole buckets overlapping the range, like the pyramid returns. Those
+    // before the first one after `rawFromMs` come from the rollups
+    const int64_t step = *resolutionMs;
+    TPyramidSlice slice{std::chrono::milliseconds(step), {}};
+    int64_t splitMs = GetBucketStartMs(fromMs, step);
+    if (fromMs < rawFromMs) {
+        const auto tier = step % DayMs == 0 ? EReadingsTier::Daily : EReadingsTier::Hourly;
+        const int64_t rollupsFromMs = splitMs;
+        splitMs = std::min((rawFromMs + step - 1) / step * step, toMs);
+        slice.Buckets = Db_->QueryRollups(tier, step, rollupsFromMs, splitMs);
+    }
+    if (splitMs < toMs) {
+        auto raw = Db_->AggregateRaw(step, splitMs, toMs);
+        slice.Buckets.insert(slice.Buckets.end(), raw.begin(), raw.end());
+    }
+    return slice;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NService
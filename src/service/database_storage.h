@@ -1,53 +1,133 @@
 #pragma once
 
 #include <service/storage.h>
+#include <service/batch_writer.h>
+#include <service/readings_db.h>
+#include <service/readings_cache.h>
+#include <service/retention_janitor.h>
+#include <service/reading_spool.h>
 
 #include <ipc/db_client.h>
 
-#include <common/atomic_intrusive_ptr.h>
+#include <common/metrics.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
 
 namespace NService {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+//! Tables live in PostgreSQL unless another TReadingsDbBase is passed.
+//! The cache is loaded in full on startup and on Resync, after that every
+//! ingest applies only the rows it inserted. Hourly and daily averages are
+//! rollups the database keeps up to date as readings are written.
 class TDataBaseStorage
     : public TTemperatureStorage
 {
 public:
     TDataBaseStorage(NIpc::TDataBaseConfigPtr config);
+    TDataBaseStorage(NIpc::TDataBaseConfigPtr config, std::unique_ptr<TReadingsDbBase> db);
+    ~TDataBaseStorage() override;
     
-    const std::deque<TReading>& GetRawReadings() override;
-    const std::deque<TReading>& GetHourlyAverage() override;
-    const std::deque<TReading>& GetDailyAverage() override;
+    TReadingSeries GetRawReadings() override;
+    TReadingSeries GetHourlyAverage() override;
+    TReadingSeries GetDailyAverage() override;
+
+    TReadingSeries GetRange(
+        EReadingsTier tier,
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t limit) override;
+
+    std::optional<TPyramidSlice> GetAggregates(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t minPoints) override;
     
     void ProcessTemperature(const TReading& reading) override;
 
-    void CreateTables();
-    void LoadLastAverages();
+    //! Reloads the whole cache from the database.
+    void Resync();
 
 private:
-    struct AverageRecord {
-        int64_t TimestampMs;
-        double AvgTemperature;
-    };
-    
-    void InsertRawReading(int64_t ts_ms, double temp);
-    void ProcessHourlyAverage(int64_t current_ts);
-    void ProcessDailyAverage(int64_t current_ts);
+    //! Follower side: appends the rows of a notification to the cache.
+    void ApplyNotification(const std::string& payload);
 
-    std::deque<TReading> ConvertTemperature(const pqxx::result& result);
-    std::deque<TReading> ConvertAverages(const pqxx::result& result);
-    
+    //! Writes readings or spools them when the spool is not empty or the
+    //! write fails.
+    void IngestBatch(std::span<const TReading> readings);
+
+    //! Writes readings ordered by time and updates the cache, returns false
+    //! if the write failed. A single reading is written with one round trip
+    //! unless it is replayed. Replayed raw rows that already exist are skipped.
+    bool WriteReadings(std::span<const TReading> readings, bool replay);
+
+    void SpoolReadings(std::span<const TReading> readings);
+
+    void ReplayLoop();
+
+    //! Writes the spool to the database in `spool_replay_batch_size` batches,
+    //! returns false if the database is still unavailable.
+    bool ReplaySpool();
+
+    //! Janitor pass: trims the cache and removes expired rows from the database.
+    size_t RemoveExpired();
+
+    //! Raw readings newer than this relative to the newest one are cached.
+    //! With `pushdown` only `hot_window_ms` of them, older raw ranges and
+    //! aggregates are queried from the database.
+    int64_t GetCachedRawMs() const;
+
+    //! Rows bucketed by the database at the pyramid resolutions, older than
+    //! raw retention from the hourly or daily rollups. Returns nullopt when
+    //! even the finest resolution spans fewer than `minPoints` buckets.
+    std::optional<TPyramidSlice> QueryAggregates(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t minPoints);
+
+    //! Reloads the cache, on failure keeps the current one and leaves
+    //! the reload to the next write.
     void RefreshCache();
 
-    std::optional<AverageRecord> LastHourly_;
-    std::optional<AverageRecord> LastDaily_;
-    
     NIpc::TDataBaseConfigPtr Config_;
-    NIpc::TDbClientPtr Client_;
+    std::unique_ptr<TReadingsDbBase> Db_;
     
-    NCommon::TAtomicIntrusivePtr<TCache> Cache_;
+    //! Serializes writers, readers only acquire the cache.
+    std::mutex WriteMutex_;
+    TReadingsCache Cache_;
+
+    //! Set when the cache may have diverged from the database.
+    bool ResyncRequired_ = false;
+
+    //! Not set on a follower.
+    std::unique_ptr<TBatchWriter> Writer_;
+
+    //! Set unless `spool_path` is empty. Takes the readings that fail to be
+    //! written and all readings after them, the replayer writes it back once
+    //! the database is reachable.
+    std::optional<TReadingSpool> Spool_;
+
+    std::mutex ReplayMutex_;
+    std::condition_variable ReplayCondition_;
+    bool ReplayStopping_ = false;
+
+    std::shared_ptr<NMetrics::TGauge> SpooledRecords_;
+
+    std::thread Replayer_;
+
+    //! Set on a follower, which does not write and appends the rows the
+    //! writer inserts to its cache.
+    NIpc::TDbListenerPtr Listener_;
 
+    //! Deletes expired rows every `retention_interval_ms`, or drops expired
+    //! partitions of `partitioned` tables.
+    std::unique_ptr<TRetentionJanitor> Janitor_;
 
 };
 
@@ -1,4 +1,9 @@
 #include <service/file_storage.h>
+#include <service/readings_io.h>
+#include <service/segmented_log.h>
+#include <service/ring_file.h>
+
+#include <common/logging.h>
 
 namespace NService {
 
@@ -8,64 +13,21 @@ namespace {
 
 inline const std::string LoggingSource = "FileStorage";
 
-#ifdef _WIN32
-time_t timegm(struct tm* tm) {
-    _tzset();
-    return _mkgmtime(tm);
-}
-#endif
-
-std::string ReadingToString(TReading reading) {
-    auto time = std::chrono::system_clock::to_time_t(reading.timestamp);
-    std::ostringstream oss;
-    oss << std::put_time(gmtime(&time), "%Y-%m-%dT%H:%M:%SZ") << " "
-        << std::fixed << std::setprecision(std::numeric_limits<double>::digits10 + 1)
-        << reading.temperature;
-    return oss.str();
-}
-
-TReading StringToReading(const std::string& str) {
-    std::istringstream iss(str);
-    std::tm tm = {};
-    std::string datetime;
-    double temp;
-    iss >> datetime >> temp;
-    
-    std::istringstream dtstream(datetime);
-    dtstream >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
-    tm.tm_isdst = 0;
-    time_t timestamp = timegm(&tm);
-    
-    return {
-        std::chrono::system_clock::from_time_t(timestamp),
-        temp
-    };
-}
-
-std::deque<TReading> ReadingsFromFile(const std::filesystem::path& file) {
-    std::deque<TReading> data;
-    try {
-        std::fstream fin(file, std::ios::in);
-        std::string str;
-        while (std::getline(fin, str)) {
-            data.emplace_front(StringToReading(str));
+std::unique_ptr<TRawLogBase> CreateRawLog(const NConfig::TFileStorageConfigPtr& config) {
+    switch (config->RawLayout) {
+        case NConfig::ERawLayout::Segments:
+            return std::make_unique<TSegmentedLog>(config->TemperaturePath, config->SegmentDuration, config->Format);
+        case NConfig::ERawLayout::Ring: {
+            auto ringPath = config->TemperaturePath;
+            ringPath.replace_extension(".ring");
+            return std::make_unique<TRingFile>(ringPath, config->RingCapacity);
         }
-    } catch (std::exception& ex) {
-        LOG_WARNING("Failed to read file with readings (File: {}, Exception: {})", file, ex);
     }
-    return data;
+    THROW("Unknown raw layout");
 }
 
-void ReadingsToFile(const std::filesystem::path& file, const std::deque<TReading>& data) {
-    try {
-        std::filesystem::create_directory(file.parent_path());
-        std::fstream fout(file, std::ios::out);
-        for (const auto& reading : data) {
-            fout << ReadingToString(reading) << '\n';
-        }
-    } catch (std::exception& ex) {
-        LOG_WARNING("Failed to write readings to file (File: {}, Exception: {})", file, ex);
-    }
+std::chrono::microseconds ElapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,100 +37,297 @@ void ReadingsToFile(const std::filesystem::path& file, const std::deque<TReading
 ////////////////////////////////////////////////////////////////////////////////
 
 TFileStorage::TFileStorage(NConfig::TFileStorageConfigPtr config)
-    : Config_(config)
+    : Config_(config),
+      RawLog_(CreateRawLog(Config_)),
+      Rollup_(Config_->RollupStatePath),
+      FlushLatency_(NMetrics::GetMetricRegistry().GetHistogram("file_storage_flush_latency_us", NMetrics::ExponentialBounds(1e7))),
+      FlushBatchSize_(NMetrics::GetMetricRegistry().GetHistogram("file_storage_flush_batch_size", NMetrics::ExponentialBounds(1e5))),
+      SyncLatency_(NMetrics::GetMetricRegistry().GetHistogram("file_storage_sync_latency_us", NMetrics::ExponentialBounds(1e7))),
+      PendingRecords_(NMetrics::GetMetricRegistry().GetGauge("file_storage_pending_records")),
+      FlushedRecords_(NMetrics::GetMetricRegistry().GetCounter("file_storage_flushed_records"))
 {
     TCachePtr initialCache = NCommon::New<TCache>();
-    initialCache->rawReadings = ReadingsFromFile(Config_->TemperaturePath);
+    initialCache->rawReadings = RawLog_->ReadAll();
+    MigrateLegacyRawFile(initialCache->rawReadings);
     initialCache->hourlyAverages = ReadingsFromFile(Config_->TemperatureHourPath);
     initialCache->dailyAverages = ReadingsFromFile(Config_->TemperatureDayPath);
+
+    Rollup_.Restore(initialCache->rawReadings, initialCache->hourlyAverages, initialCache->dailyAverages);
+    initialCache->pyramid.Load(Config_->PyramidStatePath);
+
+    // Replay readings that arrived after the states were saved
+    const auto& raw = initialCache->rawReadings;
+    if (auto last = Rollup_.GetLastTimestamp()) {
+        for (auto iter = raw.LowerBound(*last + std::chrono::milliseconds(1)); iter != raw.end(); ++iter) {
+            ApplyRollup(initialCache, Rollup_.Add(*iter));
+        }
+    }
+
+    auto pyramidLast = initialCache->pyramid.GetLastTimestamp();
+    auto pyramidBegin = pyramidLast ? raw.LowerBound(*pyramidLast + std::chrono::milliseconds(1)) : raw.begin();
+    for (auto iter = pyramidBegin; iter != raw.end(); ++iter) {
+        initialCache->pyramid.Add(*iter);
+    }
+
     Cache_.Store(initialCache);
+
+    LastSync_ = std::chrono::steady_clock::now();
+    Flusher_ = std::thread(&TFileStorage::FlusherLoop, this);
+
+    Janitor_ = std::make_unique<TRetentionJanitor>("file_storage", [this] { return RemoveExpired(); }, Config_->RetentionInterval);
+    Janitor_->Start();
 }
 
-void TFileStorage::ProcessTemperature(const TReading& reading) {
+TFileStorage::~TFileStorage() {
+    Janitor_.reset();
+
+    {
+        auto guard = std::lock_guard(PendingMutex_);
+        Stopping_ = true;
+    }
+    PendingCondition_.notify_one();
+    Flusher_.join();
+}
+
+void TFileStorage::ProcessTemperature(const TReading& received) {
+    // Stored as the files keep it, so the replay after a restart and the
+    // averages persisted before it compare the same timestamps
+    const TReading reading{std::chrono::floor<std::chrono::milliseconds>(received.timestamp), received.temperature};
+
+    auto guard = std::lock_guard(WriteMutex_);
+
     TCachePtr currentCache = Cache_.Acquire();
     TCachePtr newCache = NCommon::New<TCache>();
     
-    // Copy the existing data
+    // Share the existing data, copying a series is O(1)
     newCache->rawReadings = currentCache->rawReadings;
     newCache->hourlyAverages = currentCache->hourlyAverages;
     newCache->dailyAverages = currentCache->dailyAverages;
+    newCache->pyramid = currentCache->pyramid;
     
     newCache->rawReadings.push_back(reading);
-    
-    const auto hour_ago = reading.timestamp - std::chrono::hours(1);
-    const auto day_ago = reading.timestamp - std::chrono::days(1);
-    const auto month_ago = reading.timestamp - std::chrono::days(30);
-    const auto year_ago = reading.timestamp - std::chrono::days(360);
+    newCache->pyramid.Add(reading);
 
-    while (!newCache->rawReadings.empty() && newCache->rawReadings.front().timestamp < day_ago) {
-        newCache->rawReadings.pop_front();
+    {
+        auto pendingGuard = std::lock_guard(PendingMutex_);
+        Pending_.Readings.push_back(reading);
+        PendingRecords_->Set(Pending_.Readings.size());
     }
-    
-    while (!newCache->hourlyAverages.empty() && newCache->hourlyAverages.front().timestamp < month_ago) {
-        newCache->hourlyAverages.pop_front();
+
+    ApplyRollup(newCache, Rollup_.Add(reading));
+
+    Cache_.Store(newCache);
+    PendingCondition_.notify_one();
+}
+
+size_t TFileStorage::RemoveExpired() {
+    std::chrono::system_clock::time_point dayAgo;
+    size_t removed = 0;
+    {
+        auto guard = std::lock_guard(WriteMutex_);
+
+        TCachePtr currentCache = Cache_.Acquire();
+        if (currentCache->rawReadings.empty()) {
+            return 0;
+        }
+
+        TCachePtr newCache = NCommon::New<TCache>();
+        newCache->rawReadings = currentCache->rawReadings;
+        newCache->hourlyAverages = currentCache->hourlyAverages;
+        newCache->dailyAverages = currentCache->dailyAverages;
+        newCache->pyramid = currentCache->pyramid;
+
+        const auto newest = newCache->rawReadings.back().timestamp;
+        dayAgo = newest - std::chrono::days(1);
+
+        const size_t before = newCache->rawReadings.size() + newCache->hourlyAverages.size() + newCache->dailyAverages.size();
+        newCache->rawReadings.DropBefore(dayAgo);
+        newCache->hourlyAverages.DropBefore(newest - std::chrono::days(30));
+        newCache->dailyAverages.DropBefore(newest - std::chrono::days(360));
+        removed = before - newCache->rawReadings.size() - newCache->hourlyAverages.size() - newCache->dailyAverages.size();
+
+        if (removed == 0) {
+            return 0;
+        }
+        Cache_.Store(newCache);
+    }
+
+    // The raw log belongs to the flusher thread
+    {
+        auto guard = std::lock_guard(PendingMutex_);
+        Pending_.DropBefore = dayAgo;
+    }
+    PendingCondition_.notify_one();
+    return removed;
+}
+
+void TFileStorage::ApplyRollup(const TCachePtr& cache, const TRollupResult& rollup) {
+    if (!rollup.Hourly) {
+        return;
     }
 
-    while (!newCache->dailyAverages.empty() && newCache->dailyAverages.front().timestamp < year_ago) {
-        newCache->dailyAverages.pop_front();
+    // Averages replayed after a crash may already be persisted
+    auto& hourly = cache->hourlyAverages;
+    if (hourly.empty() || hourly.back().timestamp < rollup.Hourly->timestamp) {
+        hourly.push_back(*rollup.Hourly);
     }
 
-    ReadingsToFile(Config_->TemperaturePath, newCache->rawReadings);
+    bool dailyChanged = false;
+    auto& daily = cache->dailyAverages;
+    if (rollup.Daily && (daily.empty() || daily.back().timestamp < rollup.Daily->timestamp)) {
+        daily.push_back(*rollup.Daily);
+        dailyChanged = true;
+    }
 
-    // Create hourly average temperature
-    bool hourlyUpdate = newCache->hourlyAverages.empty() && newCache->rawReadings.front().timestamp < hour_ago
-        || !newCache->hourlyAverages.empty() && newCache->hourlyAverages.back().timestamp < hour_ago;
+    auto guard = std::lock_guard(PendingMutex_);
+    Pending_.Averages = cache;
+    Pending_.DailyChanged |= dailyChanged;
+    Pending_.RollupState = Rollup_;
+}
 
-    if (!hourlyUpdate) {
-        Cache_.Store(newCache);
+////////////////////////////////////////////////////////////////////////////////
+
+bool TFileStorage::TPendingWrites::Empty() const {
+    return Readings.empty() && !DropBefore && !Averages;
+}
+
+void TFileStorage::FlusherLoop() {
+    const auto& durability = Config_->Durability;
+    auto lock = std::unique_lock(PendingMutex_);
+
+    while (true) {
+        auto ready = [&] { return Stopping_ || !Pending_.Empty(); };
+        if (durability.Mode == NConfig::EDurability::Interval && UnsyncedRecords_ > 0) {
+            PendingCondition_.wait_until(lock, LastSync_ + durability.SyncInterval, ready);
+        } else {
+            PendingCondition_.wait(lock, ready);
+        }
+
+        auto writes = std::exchange(Pending_, TPendingWrites());
+        bool stopping = Stopping_;
+        PendingRecords_->Set(0);
+        lock.unlock();
+
+        try {
+            Flush(writes);
+        } catch (std::exception& ex) {
+            LOG_ERROR("Failed to flush pending writes (Exception: {})", ex);
+        }
+        SyncIfNeeded(stopping);
+
+        lock.lock();
+        if (stopping && Pending_.Empty()) {
+            break;
+        }
+    }
+}
+
+void TFileStorage::Flush(TPendingWrites& writes) {
+    if (writes.Empty()) {
         return;
     }
 
-    // Calculate hourly average
-    double sum = 0;
-    size_t count = 0;
-    for (auto iter = newCache->rawReadings.rbegin(); iter != newCache->rawReadings.rend() && iter->timestamp >= hour_ago; iter++) {
-        count++;
-        sum += iter->temperature;
+    auto start = std::chrono::steady_clock::now();
+
+    // Raw readings go first, replay after a crash relies on them
+    if (!writes.Readings.empty()) {
+        RawLog_->Append(writes.Readings);
+        UnsyncedRecords_ += writes.Readings.size();
+    }
+    if (writes.DropBefore) {
+        RawLog_->DropBefore(*writes.DropBefore);
     }
-    newCache->hourlyAverages.emplace_back(reading.timestamp, sum / count);
 
-    ReadingsToFile(Config_->TemperatureHourPath, newCache->hourlyAverages);
-    
-    // Create daily average temperature
-    bool dailyUpdate = newCache->dailyAverages.empty() && newCache->hourlyAverages.front().timestamp < day_ago
-        || !newCache->dailyAverages.empty() && newCache->dailyAverages.back().timestamp < day_ago;
+    if (writes.Averages) {
+        ReadingsToFile(Config_->TemperatureHourPath, writes.Averages->hourlyAverages, Config_->Format);
+        if (writes.DailyChanged) {
+            ReadingsToFile(Config_->TemperatureDayPath, writes.Averages->dailyAverages, Config_->Format);
+        }
+        writes.RollupState->SaveState();
+        writes.Averages->pyramid.Save(Config_->PyramidStatePath);
+    }
 
-    if (!dailyUpdate) {
-        Cache_.Store(newCache);
+    FlushLatency_->Record(ElapsedSince(start).count());
+    FlushBatchSize_->Record(writes.Readings.size());
+    FlushedRecords_->Increment(writes.Readings.size());
+}
+
+void TFileStorage::SyncIfNeeded(bool force) {
+    const auto& durability = Config_->Durability;
+    if (UnsyncedRecords_ == 0 || durability.Mode == NConfig::EDurability::None) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    bool due = durability.Mode == NConfig::EDurability::Interval
+        ? now - LastSync_ >= durability.SyncInterval
+        : UnsyncedRecords_ >= durability.SyncRecords;
+    if (!due && !force) {
         return;
     }
 
-    // Calculate daily average
-    sum = 0;
-    count = 0;
-    for (auto iter = newCache->hourlyAverages.rbegin(); iter != newCache->hourlyAverages.rend() && iter->timestamp >= day_ago; iter++) {
-        count++;
-        sum += iter->temperature;
+    try {
+        RawLog_->Sync();
+    } catch (std::exception& ex) {
+        LOG_ERROR("Failed to sync raw log (Exception: {})", ex);
     }
-    newCache->dailyAverages.emplace_back(reading.timestamp, sum / count);
 
-    ReadingsToFile(Config_->TemperatureDayPath, newCache->dailyAverages);
+    SyncLatency_->Record(ElapsedSince(now).count());
+    UnsyncedRecords_ = 0;
+    LastSync_ = now;
+}
 
-    Cache_.Store(newCache);
+void TFileStorage::MigrateLegacyRawFile(TReadingSeries& rawReadings) {
+    if (!std::filesystem::exists(Config_->TemperaturePath)) {
+        return;
+    }
+
+    auto legacy = ReadingsFromFile(Config_->TemperaturePath);
+    LOG_INFO("Migrating {} raw readings from {} to raw log", legacy.size(), Config_->TemperaturePath);
+
+    RawLog_->Append(std::vector<TReading>(legacy.begin(), legacy.end()));
+    for (const auto& reading : rawReadings) {
+        legacy.push_back(reading);
+    }
+    rawReadings = std::move(legacy);
+
+    std::error_code ec;
+    std::filesystem::remove(Config_->TemperaturePath, ec);
+    if (ec) {
+        LOG_WARNING("Failed to remove legacy raw file (File: {}, Error: {})", Config_->TemperaturePath, ec.message());
+    }
 }
 
-const std::deque<TReading>& TFileStorage::GetRawReadings() {
+TReadingSeries TFileStorage::GetRawReadings() {
     return Cache_.Acquire()->rawReadings;
 }
 
-const std::deque<TReading>& TFileStorage::GetHourlyAverage() {
+TReadingSeries TFileStorage::GetHourlyAverage() {
     return Cache_.Acquire()->hourlyAverages;
 }
 
-const std::deque<TReading>& TFileStorage::GetDailyAverage() {
+TReadingSeries TFileStorage::GetDailyAverage() {
     return Cache_.Acquire()->dailyAverages;
 }
 
+TReadingSeries TFileStorage::GetRange(
+    EReadingsTier tier,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t limit)
+{
+    auto cache = Cache_.Acquire();
+    return SelectRange(GetTier(*cache, tier), from, to, limit);
+}
+
+std::optional<TPyramidSlice> TFileStorage::GetAggregates(
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t minPoints)
+{
+    return Cache_.Acquire()->pyramid.Query(from, to, minPoints);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace NService
@@ -2,27 +2,103 @@
 
 #include <service/storage.h>
 #include <service/config.h>
+#include <service/raw_log.h>
+#include <service/rollup_engine.h>
+#include <service/retention_janitor.h>
 #include <common/atomic_intrusive_ptr.h>
+#include <common/metrics.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace NService {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+//! Readings are published to the cache on the ingest thread and written to
+//! disk by a dedicated flusher thread, which batches everything queued since
+//! its previous pass and syncs according to the durability policy.
+//! Expired readings are removed by a janitor every `retention_interval_ms`,
+//! until then they stay visible.
 class TFileStorage
     : public TTemperatureStorage
 {
 public:
     TFileStorage(NConfig::TFileStorageConfigPtr config);
+    ~TFileStorage() override;
+
+    TReadingSeries GetRawReadings() override;
+    TReadingSeries GetHourlyAverage() override;
+    TReadingSeries GetDailyAverage() override;
 
-    const std::deque<TReading>& GetRawReadings() override;
-    const std::deque<TReading>& GetHourlyAverage() override;
-    const std::deque<TReading>& GetDailyAverage() override;
+    TReadingSeries GetRange(
+        EReadingsTier tier,
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t limit) override;
+
+    std::optional<TPyramidSlice> GetAggregates(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t minPoints) override;
 
     void ProcessTemperature(const TReading& reading) override;
 
+private:
+    //! Writes queued for the flusher.
+    struct TPendingWrites {
+        std::vector<TReading> Readings;
+        std::optional<std::chrono::system_clock::time_point> DropBefore;
+
+        //! Snapshot with the averages to persist, set when an hour closes.
+        TCachePtr Averages;
+        bool DailyChanged = false;
+        std::optional<TRollupEngine> RollupState;
+
+        bool Empty() const;
+    };
+
+    void MigrateLegacyRawFile(TReadingSeries& rawReadings);
+
+    //! Appends closed averages to the cache and queues them for persisting.
+    void ApplyRollup(const TCachePtr& cache, const TRollupResult& rollup);
+
+    void FlusherLoop();
+    void Flush(TPendingWrites& writes);
+    void SyncIfNeeded(bool force);
+
+    //! Janitor pass: trims the cache and queues dropping raw log segments.
+    size_t RemoveExpired();
+
 public:
     NConfig::TFileStorageConfigPtr Config_;
+    std::unique_ptr<TRawLogBase> RawLog_;
+    TRollupEngine Rollup_;
+
+    //! Serializes writers, readers only acquire the cache.
+    std::mutex WriteMutex_;
     NCommon::TAtomicIntrusivePtr<TCache> Cache_;
+
+    std::mutex PendingMutex_;
+    std::condition_variable PendingCondition_;
+    TPendingWrites Pending_;
+    bool Stopping_ = false;
+
+    // Owned by the flusher thread
+    uint64_t UnsyncedRecords_ = 0;
+    std::chrono::steady_clock::time_point LastSync_;
+
+    std::shared_ptr<NMetrics::THistogram> FlushLatency_;
+    std::shared_ptr<NMetrics::THistogram> FlushBatchSize_;
+    std::shared_ptr<NMetrics::THistogram> SyncLatency_;
+    std::shared_ptr<NMetrics::TGauge> PendingRecords_;
+    std::shared_ptr<NMetrics::TCounter> FlushedRecords_;
+
+    std::thread Flusher_;
+
+    std::unique_ptr<TRetentionJanitor> Janitor_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
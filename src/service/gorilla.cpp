@@ -0,0 +1,251 @@
+#include <service/gorilla.h>
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint64_t ZigZagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+//! Delta-of-delta buckets: prefix bits and payload width.
+struct TDodBucket {
+    uint64_t Prefix;
+    int PrefixBits;
+    int ValueBits;
+};
+
+constexpr TDodBucket DodBuckets[] = {
+    {0b10, 2, 7},
+    {0b110, 3, 9},
+    {0b1110, 4, 12},
+    {0b1111, 4, 64},
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TBitWriter::Write(uint64_t value, int bits) {
+    if (bits == 0) {
+        return;
+    }
+    if (bits < 64) {
+        value &= (uint64_t(1) << bits) - 1;
+    }
+
+    size_t offset = BitCount_ % 64;
+    if (offset == 0) {
+        Words_.push_back(0);
+    }
+
+    int free = 64 - static_cast<int>(offset);
+    if (bits <= free) {
+        Words_.back() |= value << (free - bits);
+    } else {
+        Words_.back() |= value >> (bits - free);
+        Words_.push_back(value << (64 - (bits - free)));
+    }
+    BitCount_ += bits;
+}
+
+void TBitWriter::WriteBit(bool bit) {
+    Write(bit ? 1 : 0, 1);
+}
+
+size_t TBitWriter::GetBitCount() const {
+    return BitCount_;
+}
+
+std::vector<uint64_t> TBitWriter::Finish() {
+    Words_.shrink_to_fit();
+    return std::move(Words_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TBitReader::TBitReader(const uint64_t* words, size_t bitCount)
+    : Words_(words), BitCount_(bitCount)
+{}
+
+uint64_t TBitReader::Read(int bits) {
+    if (bits == 0) {
+        return 0;
+    }
+
+    size_t word = Position_ / 64;
+    int offset = static_cast<int>(Position_ % 64);
+    int available = 64 - offset;
+    Position_ += bits;
+
+    uint64_t result;
+    if (bits <= available) {
+        result = Words_[word] >> (available - bits);
+    } else {
+        result = (Words_[word] << (bits - available)) | (Words_[word + 1] >> (64 - (bits - available)));
+    }
+    return bits < 64 ? result & ((uint64_t(1) << bits) - 1) : result;
+}
+
+bool TBitReader::ReadBit() {
+    return Read(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TGorillaEncoder::Append(int64_t timestamp, double value) {
+    AppendTimestamp(timestamp);
+    AppendValue(value);
+    Count_++;
+}
+
+void TGorillaEncoder::AppendTimestamp(int64_t timestamp) {
+    if (Count_ == 0) {
+        Writer_.Write(static_cast<uint64_t>(timestamp), 64);
+        PrevTimestamp_ = timestamp;
+        return;
+    }
+
+    // Wrapping arithmetic keeps arbitrary timestamps lossless.
+    int64_t delta = static_cast<int64_t>(static_cast<uint64_t>(timestamp) - static_cast<uint64_t>(PrevTimestamp_));
+    uint64_t dod = ZigZagEncode(static_cast<int64_t>(static_cast<uint64_t>(delta) - static_cast<uint64_t>(PrevDelta_)));
+    PrevTimestamp_ = timestamp;
+    PrevDelta_ = delta;
+
+    if (dod == 0) {
+        Writer_.WriteBit(false);
+        return;
+    }
+
+    for (const auto& bucket : DodBuckets) {
+        if (bucket.ValueBits == 64 || dod < (uint64_t(1) << bucket.ValueBits)) {
+            Writer_.Write(bucket.Prefix, bucket.PrefixBits);
+            Writer_.Write(dod, bucket.ValueBits);
+            return;
+        }
+    }
+}
+
+void TGorillaEncoder::AppendValue(double value) {
+    uint64_t bits = std::bit_cast<uint64_t>(value);
+
+    if (Count_ == 0) {
+        Writer_.Write(bits, 64);
+        PrevValue_ = bits;
+        return;
+    }
+
+    uint64_t xored = bits ^ PrevValue_;
+    PrevValue_ = bits;
+
+    if (xored == 0) {
+        Writer_.WriteBit(false);
+        return;
+    }
+    Writer_.WriteBit(true);
+
+    int leading = std::min(std::countl_zero(xored), 31);
+    int trailing = std::countr_zero(xored);
+
+    if (PrevLeading_ >= 0 && leading >= PrevLeading_ && trailing >= PrevTrailing_) {
+        Writer_.WriteBit(false);
+        Writer_.Write(xored >> PrevTrailing_, 64 - PrevLeading_ - PrevTrailing_);
+        return;
+    }
+
+    int meaningful = 64 - leading - trailing;
+    Writer_.WriteBit(true);
+    Writer_.Write(leading, 5);
+    Writer_.Write(meaningful == 64 ? 0 : meaningful, 6);
+    Writer_.Write(xored >> trailing, meaningful);
+
+    PrevLeading_ = leading;
+    PrevTrailing_ = trailing;
+}
+
+size_t TGorillaEncoder::GetCount() const {
+    return Count_;
+}
+
+std::vector<uint64_t> TGorillaEncoder::Finish() {
+    return Writer_.Finish();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TGorillaDecoder::TGorillaDecoder(const std::vector<uint64_t>& data, size_t count)
+    : Reader_(data.data(), data.size() * 64),
+      Count_(count)
+{}
+
+bool TGorillaDecoder::Next(int64_t& timestamp, double& value) {
+    if (Position_ == Count_) {
+        return false;
+    }
+
+    timestamp = ReadTimestamp();
+    value = ReadValue();
+    Position_++;
+    return true;
+}
+
+int64_t TGorillaDecoder::ReadTimestamp() {
+    if (Position_ == 0) {
+        PrevTimestamp_ = static_cast<int64_t>(Reader_.Read(64));
+        return PrevTimestamp_;
+    }
+
+    int64_t dod = 0;
+    if (Reader_.ReadBit()) {
+        for (size_t index = 0; ; index++) {
+            const auto& bucket = DodBuckets[index];
+            if (index + 1 == std::size(DodBuckets) || !Reader_.ReadBit()) {
+                dod = ZigZagDecode(Reader_.Read(bucket.ValueBits));
+                break;
+            }
+        }
+    }
+
+    PrevDelta_ = static_cast<int64_t>(static_cast<uint64_t>(PrevDelta_) + static_cast<uint64_t>(dod));
+    PrevTimestamp_ = static_cast<int64_t>(static_cast<uint64_t>(PrevTimestamp_) + static_cast<uint64_t>(PrevDelta_));
+    return PrevTimestamp_;
+}
+
+double TGorillaDecoder::ReadValue() {
+    if (Position_ == 0) {
+        PrevValue_ = Reader_.Read(64);
+        return std::bit_cast<double>(PrevValue_);
+    }
+
+    if (Reader_.ReadBit()) {
+        if (Reader_.ReadBit()) {
+            PrevLeading_ = static_cast<int>(Reader_.Read(5));
+            int meaningful = static_cast<int>(Reader_.Read(6));
+            if (meaningful == 0) {
+                meaningful = 64;
+            }
+            PrevTrailing_ = 64 - PrevLeading_ - meaningful;
+        }
+
+        int meaningful = 64 - PrevLeading_ - PrevTrailing_;
+        PrevValue_ ^= Reader_.Read(meaningful) << PrevTrailing_;
+    }
+
+    return std::bit_cast<double>(PrevValue_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TBitWriter {
+public:
+    //! Appends `bits` lowest bits of `value`, most significant first.
+    void Write(uint64_t value, int bits);
+    void WriteBit(bool bit);
+
+    size_t GetBitCount() const;
+
+    std::vector<uint64_t> Finish();
+
+private:
+    std::vector<uint64_t> Words_;
+    size_t BitCount_ = 0;
+};
+
+class TBitReader {
+public:
+    TBitReader(const uint64_t* words, size_t bitCount);
+
+    uint64_t Read(int bits);
+    bool ReadBit();
+
+private:
+    const uint64_t* Words_;
+    size_t BitCount_;
+    size_t Position_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Gorilla encoding of (timestamp, value) pairs: delta-of-delta timestamps
+//! and XOR-encoded doubles, see "Gorilla: A Fast, Scalable, In-Memory Time
+//! Series Database" (Pelkonen et al., VLDB 2015).
+class TGorillaEncoder {
+public:
+    void Append(int64_t timestamp, double value);
+
+    size_t GetCount() const;
+
+    std::vector<uint64_t> Finish();
+
+private:
+    void AppendTimestamp(int64_t timestamp);
+    void AppendValue(double value);
+
+    TBitWriter Writer_;
+    size_t Count_ = 0;
+
+    int64_t PrevTimestamp_ = 0;
+    int64_t PrevDelta_ = 0;
+
+    uint64_t PrevValue_ = 0;
+    int PrevLeading_ = -1;
+    int PrevTrailing_ = 0;
+};
+
+class TGorillaDecoder {
+public:
+    TGorillaDecoder(const std::vector<uint64_t>& data, size_t count);
+
+    bool Next(int64_t& timestamp, double& value);
+
+private:
+    int64_t ReadTimestamp();
+    double ReadValue();
+
+    TBitReader Reader_;
+    size_t Count_;
+    size_t Position_ = 0;
+
+    int64_t PrevTimestamp_ = 0;
+    int64_t PrevDelta_ = 0;
+
+    uint64_t PrevValue_ = 0;
+    int PrevLeading_ = 0;
+    int PrevTrailing_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,266 @@
+#include <service/memory_readings_db.h>
+
+#include <common/exception.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "MemoryReadingsDb";
+
+template <typename TTable>
+auto LowerBound(TTable& table, int64_t timestampMs) {
+    return std::lower_bound(table.begin(), table.end(), timestampMs, [] (const auto& row, int64_t value) {
+        return row.first < value;
+    });
+}
+
+template <typename TValue>
+auto LowerBound(std::map<int64_t, TValue>& table, int64_t timestampMs) {
+    return table.lower_bound(timestampMs);
+}
+
+std::chrono::system_clock::time_point FromMilliseconds(int64_t timestampMs) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs));
+}
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TMemoryReadingsDb::TTransaction
+    : public TReadingsDbTransactionBase
+{
+public:
+    explicit TTransaction(TMemoryReadingsDb& db)
+        : Db_(db),
+          Lock_(db.Mutex_)
+    {}
+
+    ~TTransaction() override {
+        // Rolls back in reverse, so every row is found where it was inserted.
+        // Every rollup gets back the value it had before the transaction
+        for (auto& [key, previous] : Updated_) {
+            auto& [table, startMs] = key;
+            if (previous) {
+                (*table)[startMs] = *previous;
+            } else {
+                table->erase(startMs);
+            }
+        }
+        for (auto it = Inserted_.rbegin(); it != Inserted_.rend(); ++it) {
+            auto& [table, timestampMs] = *it;
+            table->erase(LowerBound(*table, timestampMs));
+        }
+    }
+
+    std::vector<TReading> WriteReadings(std::span<const TReading> readings, bool skipExisting) override {
+        std::vector<TReading> inserted;
+        inserted.reserve(readings.size());
+        for (const auto& reading : readings) {
+            const int64_t timestampMs = ToMilliseconds(reading.timestamp);
+            if (!Insert(Db_.Raw_, timestampMs, reading.temperature)) {
+                if (!skipExisting) {
+                    THROW("Duplicate key {} in raw_temperatures", timestampMs);
+                }
+                continue;
+            }
+            Upsert(Db_.Hourly_, GetBucketStartMs(timestampMs, HourMs), reading.temperature);
+            Upsert(Db_.Daily_, GetBucketStartMs(timestampMs, DayMs), reading.temperature);
+            inserted.push_back(reading);
+        }
+        return inserted;
+    }
+
+    void Commit() override {
+        ASSERT(Lock_.owns_lock(), "Transaction is already finished");
+        Inserted_.clear();
+        Updated_.clear();
+        Lock_.unlock();
+    }
+
+private:
+    //! Returns false if the timestamp is already in the table.
+    bool Insert(TTable& table, int64_t timestampMs, double value) {
+        ASSERT(Lock_.owns_lock(), "Transaction is already finished");
+
+        if (table.empty() || table.back().first < timestampMs) {
+            table.emplace_back(timestampMs, value);
+        } else {
+            auto it = LowerBound(table, timestampMs);
+            if (it->first == timestampMs) {
+                return false;
+            }
+            table.emplace(it, timestampMs, value);
+        }
+        Inserted_.emplace_back(&table, timestampMs);
+        return true;
+    }
+
+    void Upsert(TRollupTable& table, int64_t startMs, double value) {
+        auto [it, inserted] = table.try_emplace(startMs);
+        // Only the value before the first update of the transaction is kept
+        auto [undo, first] = Updated_.try_emplace({&table, startMs});
+        if (inserted) {
+            it->second.Reset(FromMilliseconds(startMs));
+        } else if (first) {
+            undo->second = it->second;
+        }
+        it->second.Add(value);
+    }
+
+    TMemoryReadingsDb& Db_;
+    std::unique_lock<std::mutex> Lock_;
+
+    //! Undone unless committed.
+    std::vector<std::pair<TTable*, int64_t>> Inserted_;
+    std::map<std::pair<TRollupTable*, int64_t>, std::optional<TRollupBucket>> Updated_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TMemoryReadingsDb::CreateSchema(bool /*notifyFollowers*/) {
+}
+
+TReadingsSnapshot TMemoryReadingsDb::LoadSnapshot(int64_t rawRetentionMs) {
+    auto guard = std::lock_guard(Mutex_);
+
+    TReadingsSnapshot snapshot{NCommon::New<TCache>(), {}, {}};
+    if (!Raw_.empty()) {
+        for (auto it = LowerBound(Raw_, Raw_.back().first - rawRetentionMs); it != Raw_.end(); ++it) {
+            snapshot.Cache->rawReadings.push_back({FromMilliseconds(it->first), it->second});
+        }
+    }
+
+    // The newest rollup is open, the others are closed
+    auto load = [] (const TRollupTable& table, int64_t retentionMs, TReadingSeries& averages, TRollupBucket& open) {
+        if (table.empty()) {
+            return;
+        }
+        const auto newest = std::prev(table.end());
+        for (auto it = table.lower_bound(newest->first - retentionMs); it != newest; ++it) {
+            averages.push_back({FromMilliseconds(it->first), it->second.GetAverage()});
+        }
+        open = newest->second;
+    };
+    load(Hourly_, HourlyRetentionMs, snapshot.Cache->hourlyAverages, snapshot.OpenHour);
+    load(Daily_, DailyRetentionMs, snapshot.Cache->dailyAverages, snapshot.OpenDay);
+    return snapshot;
+}
+
+void TMemoryReadingsDb::IngestReading(const TReading& reading) {
+    auto tx = BeginTransaction();
+    tx->WriteReadings({&reading, 1}, false);
+    tx->Commit();
+}
+
+std::unique_ptr<TReadingsDbTransactionBase> TMemoryReadingsDb::BeginTransaction() {
+    return std::make_unique<TTransaction>(*this);
+}
+
+size_t TMemoryReadingsDb::RemoveExpired(std::optional<int64_t> newestMs) {
+    if (!newestMs) {
+        return 0;
+    }
+
+    auto guard = std::lock_guard(Mutex_);
+    auto expire = [] (auto& table, int64_t beforeMs) -> size_t {
+        auto end = LowerBound(table, beforeMs);
+        const size_t removed = std::distance(table.begin(), end);
+        table.erase(table.begin(), end);
+        return removed;
+    };
+    return expire(Raw_, *newestMs - RawRetentionMs)
+        + expire(Hourly_, *newestMs - HourlyRetentionMs)
+        + expire(Daily_, *newestMs - DailyRetentionMs);
+}
+
+TReadingSeries TMemoryReadingsDb::QueryRawRange(int64_t fromMs, int64_t toMs, size_t limit) {
+    auto guard = std::lock_guard(Mutex_);
+
+    TReadingSeries readings;
+    if (Raw_.empty()) {
+        return readings;
+    }
+    auto first = LowerBound(Raw_, std::max(fromMs, Raw_.back().first - RawRetentionMs));
+    auto last = LowerBound(Raw_, toMs);
+    if (last <= first) {
+        return readings;
+    }
+    if (static_cast<size_t>(last - first) > limit) {
+        first = last - limit;
+    }
+    for (auto it = first; it != last; ++it) {
+        readings.push_back({FromMilliseconds(it->first), it->second});
+    }
+    return readings;
+}
+
+std::optional<std::pair<int64_t, int64_t>> TMemoryReadingsDb::GetRawBounds() {
+    auto guard = std::lock_guard(Mutex_);
+    if (Raw_.empty()) {
+        return std::nullopt;
+    }
+    return std::pair(Raw_.front().first, Raw_.back().first);
+}
+
+std::vector<TPyramidBucket> TMemoryReadingsDb::AggregateRaw(int64_t resolutionMs, int64_t fromMs, int64_t toMs) {
+    auto guard = std::lock_guard(Mutex_);
+
+    std::vector<TPyramidBucket> buckets;
+    for (auto it = LowerBound(Raw_, fromMs); it != Raw_.end() && it->first < toMs; ++it) {
+        // Truncating division, as in SQL
+        const auto start = FromMilliseconds(it->first / resolutionMs * resolutionMs);
+        if (buckets.empty() || buckets.back().Start != start) {
+            buckets.push_back({start, it->second, it->second, 0, 0});
+        }
+        auto& bucket = buckets.back();
+        bucket.Min = std::min(bucket.Min, it->second);
+        bucket.Max = std::max(bucket.Max, it->second);
+        bucket.Sum += it->second;
+        bucket.Count++;
+    }
+    return buckets;
+}
+
+std::vector<TPyramidBucket> TMemoryReadingsDb::QueryRollups(EReadingsTier tier, int64_t resolutionMs, int64_t fromMs, int64_t toMs) {
+    auto guard = std::lock_guard(Mutex_);
+    auto& table = tier == EReadingsTier::Daily ? Daily_ : Hourly_;
+
+    std::vector<TPyramidBucket> buckets;
+    for (auto it = table.lower_bound(fromMs); it != table.end() && it->first < toMs; ++it) {
+        const auto& rollup = it->second;
+        const auto start = FromMilliseconds(it->first / resolutionMs * resolutionMs);
+        if (buckets.empty() || buckets.back().Start != start) {
+            buckets.push_back({start, rollup.Min, rollup.Max, 0, 0});
+        }
+        auto& bucket = buckets.back();
+        bucket.Min = std::min(bucket.Min, rollup.Min);
+        bucket.Max = std::max(bucket.Max, rollup.Max);
+        bucket.Sum += rollup.Sum;
+        bucket.Count += rollup.Count;
+    }
+    return buckets;
+}
+
+NIpc::TDbListenerPtr TMemoryReadingsDb::CreateListener(
+    NIpc::TDbListener::THandler /*handler*/,
+    std::function<void()> /*onConnected*/)
+{
+    THROW("The in-memory database has no followers");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
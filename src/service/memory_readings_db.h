@@ -0,0 +1,58 @@
+#pragma once
+
+#include <service/readings_db.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! The three tables in process memory, for profiling TDataBaseStorage
+//! without a server. Statements behave as their SQL does, including the
+//! primary key on `timestamp_ms` and the rollup upserts. A transaction holds
+//! the tables locked until it is finished. Nothing is persisted and there
+//! are no followers to notify.
+class TMemoryReadingsDb
+    : public TReadingsDbBase
+{
+public:
+    void CreateSchema(bool notifyFollowers) override;
+    TReadingsSnapshot LoadSnapshot(int64_t rawRetentionMs) override;
+    void IngestReading(const TReading& reading) override;
+
+    std::unique_ptr<TReadingsDbTransactionBase> BeginTransaction() override;
+    size_t RemoveExpired(std::optional<int64_t> newestMs) override;
+
+    TReadingSeries QueryRawRange(int64_t fromMs, int64_t toMs, size_t limit) override;
+    std::optional<std::pair<int64_t, int64_t>> GetRawBounds() override;
+    std::vector<TPyramidBucket> AggregateRaw(int64_t resolutionMs, int64_t fromMs, int64_t toMs) override;
+    std::vector<TPyramidBucket> QueryRollups(EReadingsTier tier, int64_t resolutionMs, int64_t fromMs, int64_t toMs) override;
+
+    //! Throws, followers need a server.
+    NIpc::TDbListenerPtr CreateListener(
+        NIpc::TDbListener::THandler handler,
+        std::function<void()> onConnected) override;
+
+private:
+    class TTransaction;
+
+    //! Rows ordered by timestamp. Appends and expiry are amortized O(1),
+    //! rows inserted out of order shift the newer ones.
+    using TTable = std::deque<std::pair<int64_t, double>>;
+
+    //! Rollups by the start of their bucket.
+    using TRollupTable = std::map<int64_t, TRollupBucket>;
+
+    std::mutex Mutex_;
+
+    TTable Raw_;
+    TRollupTable Hourly_;
+    TRollupTable Daily_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
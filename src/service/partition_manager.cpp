@@ -0,0 +1,209 @@
+#include <service/partition_manager.h>
+
+#include <common/logging.h>
+
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "Partitions";
+
+using TDays = std::chrono::sys_days;
+
+TDays ToDays(int64_t timestampMs) {
+    return std::chrono::floor<std::chrono::days>(std::chrono::sys_time<std::chrono::milliseconds>(std::chrono::milliseconds(timestampMs)));
+}
+
+int64_t ToMilliseconds(TDays day) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(day.time_since_epoch()).count();
+}
+
+//! Start of the period containing `day`.
+TDays PeriodStart(EPartitionPeriod period, TDays day) {
+    std::chrono::year_month_day date(day);
+    switch (period) {
+        case EPartitionPeriod::Day:
+            return day;
+        case EPartitionPeriod::Month:
+            return TDays(date.year() / date.month() / 1);
+        case EPartitionPeriod::Year:
+            return TDays(date.year() / std::chrono::January / 1);
+    }
+    THROW("Unknown partition period");
+}
+
+TDays NextPeriod(EPartitionPeriod period, TDays start) {
+    std::chrono::year_month_day date(start);
+    switch (period) {
+        case EPartitionPeriod::Day:
+            return start + std::chrono::days(1);
+        case EPartitionPeriod::Month:
+            return TDays(date + std::chrono::months(1));
+        case EPartitionPeriod::Year:
+            return TDays(date + std::chrono::years(1));
+    }
+    THROW("Unknown partition period");
+}
+
+std::string PartitionName(const TPartitionedTable& table, TDays start) {
+    std::chrono::year_month_day date(start);
+    std::ostringstream out;
+    out << table.Name << "_p" << std::setfill('0') << std::setw(4) << static_cast<int>(date.year());
+    if (table.Period != EPartitionPeriod::Year) {
+        out << std::setw(2) << static_cast<unsigned>(date.month());
+    }
+    if (table.Period == EPartitionPeriod::Day) {
+        out << std::setw(2) << static_cast<unsigned>(date.day());
+    }
+    return out.str();
+}
+
+//! Inverse of PartitionName, nullopt for partitions not created here.
+std::optional<TDays> ParsePartitionStart(const TPartitionedTable& table, const std::string& name) {
+    const std::string prefix = table.Name + "_p";
+    const size_t length = table.Period == EPartitionPeriod::Year ? 4 : table.Period == EPartitionPeriod::Month ? 6 : 8;
+    if (!name.starts_with(prefix) || name.size() != prefix.size() + length) {
+        return std::nullopt;
+    }
+
+    const std::string suffix = name.substr(prefix.size());
+    if (suffix.find_first_not_of("0123456789") != std::string::npos) {
+        return std::nullopt;
+    }
+
+    std::chrono::year_month_day date(
+        std::chrono::year(std::stoi(suffix.substr(0, 4))),
+        std::chrono::month(length >= 6 ? std::stoul(suffix.substr(4, 2)) : 1),
+        std::chrono::day(length == 8 ? std::stoul(suffix.substr(6, 2)) : 1));
+    if (!date.ok()) {
+        return std::nullopt;
+    }
+    return TDays(date);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TPartitionManager::TPartitionManager(NIpc::TDbClientPtr client, std::vector<TPartitionedTable> tables, size_t ahead)
+    : Client_(std::move(client)),
+      Tables_(std::move(tables)),
+      Ahead_(ahead)
+{}
+
+void TPartitionManager::Validate() {
+    for (const auto& table : Tables_) {
+        auto result = Client_->ExecuteQuery(
+            "SELECT EXISTS (SELECT 1 FROM pg_partitioned_table WHERE partrelid = to_regclass($1))",
+            table.Name);
+        ASSERT(result[0][0].as<bool>(), "Table {} is not partitioned, migrate it or disable 'partitioned'", table.Name);
+    }
+}
+
+void TPartitionManager::Maintain(std::optional<int64_t> newestMs) {
+    auto guard = std::lock_guard(Mutex_);
+    if (newestMs) {
+        NewestMs_ = newestMs;
+    }
+
+    const int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    const int64_t newest = NewestMs_.value_or(nowMs);
+    const int64_t latest = std::max(newest, nowMs);
+    if (latest < NextMaintenanceMs_) {
+        return;
+    }
+
+    for (const auto& table : Tables_) {
+        MaintainTable(table, newest, nowMs);
+    }
+    NextMaintenanceMs_ = ToMilliseconds(ToDays(latest) + std::chrono::days(1));
+}
+
+void TPartitionManager::RequestMaintenance() {
+    auto guard = std::lock_guard(Mutex_);
+    NextMaintenanceMs_ = std::numeric_limits<int64_t>::min();
+}
+
+void TPartitionManager::MaintainTable(const TPartitionedTable& table, int64_t newestMs, int64_t nowMs) {
+    const int64_t expiredBeforeMs = newestMs - table.Retention.count();
+    const std::string defaultName = table.Name + "_default";
+
+    // Takes rows of a clock that is off instead of failing their insert
+    Client_->ExecuteQuery(NCommon::Format("CREATE TABLE IF NOT EXISTS {} PARTITION OF {} DEFAULT", defaultName, table.Name));
+
+    std::set<std::string> partitions;
+    auto rows = Client_->ExecuteQuery(
+        "SELECT c.relname FROM pg_inherits i JOIN pg_class c ON c.oid = i.inhrelid "
+        "WHERE i.inhparent = to_regclass($1)",
+        table.Name);
+    for (const auto& row : rows) {
+        partitions.insert(row[0].as<std::string>());
+    }
+
+    // Live partitions and the upcoming ones, ahead of the wall clock too when
+    // it is later. Rows between the two go to the default partition
+    std::set<TDays> starts;
+    auto addPeriods = [&] (TDays start, TDays last) {
+        for (size_t i = 0; i < Ahead_; i++) {
+            last = NextPeriod(table.Period, last);
+        }
+        for (; start <= last; start = NextPeriod(table.Period, start)) {
+            starts.insert(start);
+        }
+    };
+    addPeriods(PeriodStart(table.Period, ToDays(expiredBeforeMs)), PeriodStart(table.Period, ToDays(newestMs)));
+    if (nowMs > newestMs) {
+        const auto current = PeriodStart(table.Period, ToDays(nowMs));
+        addPeriods(current, current);
+    }
+    for (const auto& start : starts) {
+        auto name = PartitionName(table, start);
+        if (!partitions.contains(name)) {
+            CreatePartition(table, name, start);
+        }
+    }
+
+    // Partitions where every row is expired
+    for (const auto& name : partitions) {
+        auto partitionStart = ParsePartitionStart(table, name);
+        if (!partitionStart || ToMilliseconds(NextPeriod(table.Period, *partitionStart)) > expiredBeforeMs) {
+            continue;
+        }
+        Client_->ExecuteQuery(NCommon::Format("DROP TABLE IF EXISTS {}", name));
+        LOG_INFO("Dropped expired partition {}", name);
+    }
+    Client_->ExecuteQuery(NCommon::Format("DELETE FROM {} WHERE timestamp_ms < $1", defaultName), expiredBeforeMs);
+}
+
+void TPartitionManager::CreatePartition(const TPartitionedTable& table, const std::string& name, TDays start) {
+    const int64_t fromMs = ToMilliseconds(start);
+    const int64_t toMs = ToMilliseconds(NextPeriod(table.Period, start));
+
+    // Attaching checks that the default partition has no rows of the period
+    // left. The primary key is created on attach
+    auto tx = Client_->BeginTransaction();
+    tx.ExecuteQuery(NCommon::Format("CREATE TABLE {} (LIKE {} INCLUDING DEFAULTS INCLUDING CONSTRAINTS)", name, table.Name));
+    auto moved = tx.ExecuteQuery(NCommon::Format(
+        "WITH moved AS (DELETE FROM {}_default WHERE timestamp_ms >= $1 AND timestamp_ms < $2 RETURNING *) "
+        "INSERT INTO {} SELECT * FROM moved",
+        table.Name, name), fromMs, toMs);
+    tx.ExecuteQuery(NCommon::Format("ALTER TABLE {} ATTACH PARTITION {} FOR VALUES FROM ({}) TO ({})", table.Name, name, fromMs, toMs));
+    tx.Commit();
+
+    if (moved.affected_rows() > 0) {
+        LOG_INFO("Moved {} rows from the default partition into {}", moved.affected_rows(), name);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
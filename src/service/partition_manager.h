@@ -0,0 +1,73 @@
+#pragma once
+
+#include <ipc/db_client.h>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+enum class EPartitionPeriod {
+    Day,
+    Month,
+    Year,
+};
+
+struct TPartitionedTable {
+    std::string Name;
+    EPartitionPeriod Period;
+
+    //! Rows older than the newest reading by more than this are expired.
+    std::chrono::milliseconds Retention;
+};
+
+//! Keeps tables range-partitioned by `timestamp_ms` (UTC periods) in shape:
+//! partitions are created `ahead` periods in advance and a partition is
+//! dropped once all its rows are expired, so retention does not delete rows.
+//! Partitions are named `<table>_p<YYYY[MM[DD]]>` after the period start.
+//! Rows outside them go to `<table>_default` and move to their partition
+//! when it is created.
+class TPartitionManager {
+public:
+    TPartitionManager(NIpc::TDbClientPtr client, std::vector<TPartitionedTable> tables, size_t ahead);
+
+    //! Throws if one of the tables exists but is not partitioned,
+    //! such tables have to be migrated by hand.
+    void Validate();
+
+    //! Creates partitions ahead of the newest row and of the wall clock and
+    //! drops the ones expired relative to the newest row. Without `newestMs` the last one passed is used, or the wall clock.
+    //! Does nothing until that reaches the next day boundary unless
+    //! RequestMaintenance was called.
+    void Maintain(std::optional<int64_t> newestMs);
+
+    //! Makes the next Maintain run, for an insert that found no partition.
+    void RequestMaintenance();
+
+private:
+    void MaintainTable(const TPartitionedTable& table, int64_t newestMs, int64_t nowMs);
+
+    //! Creates the partition of the period at `start` with the rows of the
+    //! period that are in the default partition.
+    void CreatePartition(const TPartitionedTable& table, const std::string& name, std::chrono::sys_days start);
+
+    NIpc::TDbClientPtr Client_;
+    const std::vector<TPartitionedTable> Tables_;
+    const size_t Ahead_;
+
+    //! Serializes the janitor and writers that found no partition.
+    std::mutex Mutex_;
+    std::optional<int64_t> NewestMs_;
+    int64_t NextMaintenanceMs_ = std::numeric_limits<int64_t>::min();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
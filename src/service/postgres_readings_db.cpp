@@ -0,0 +1,485 @@
+#include <service/postgres_readings_db.h>
+
+#include <limits>
+#include <map>
+#include <string_view>
+#include <tuple>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "PostgresReadingsDb";
+
+// Prepared statements used at ingest
+const std::string UpsertRollupsStatement = "upsert_rollups";
+const std::string DeleteRawStatement = "delete_raw_before";
+const std::string DeleteHourlyStatement = "delete_hourly_before";
+const std::string DeleteDailyStatement = "delete_daily_before";
+const std::string IngestReadingStatement = "ingest_reading";
+
+// Rows inserted by the writer are sent to followers on this channel
+const std::string NotifyChannel = "temperature_readings";
+// NOTIFY payloads are limited to 8000 bytes
+const size_t MaxNotifyPayload = 7900;
+const auto ListenRetryInterval = std::chrono::seconds(1);
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromMilliseconds(int64_t timestampMs) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs));
+}
+
+//! Adds the rows of `source` (bucket start, sum, count, min, max) to the
+//! rollups in `table`, one row per bucket.
+std::string UpsertRollups(const std::string& table, const std::string& source) {
+    return NCommon::Format(
+        "INSERT INTO {} AS r (timestamp_ms, sum_temperature, reading_count, min_temperature, max_temperature) {} "
+        "ON CONFLICT (timestamp_ms) DO UPDATE SET "
+        "   sum_temperature = r.sum_temperature + EXCLUDED.sum_temperature, "
+        "   reading_count = r.reading_count + EXCLUDED.reading_count, "
+        "   min_temperature = LEAST(r.min_temperature, EXCLUDED.min_temperature), "
+        "   max_temperature = GREATEST(r.max_temperature, EXCLUDED.max_temperature)",
+        table, source);
+}
+
+//! Rollups of the raw rows of `source` per bucket of `periodMs`.
+std::string AggregateRollups(const std::string& source, int64_t periodMs) {
+    return NCommon::Format(
+        "SELECT timestamp_ms / {} * {}, SUM(temperature), COUNT(*), MIN(temperature), MAX(temperature) "
+        "FROM {} GROUP BY 1",
+        periodMs, periodMs, source);
+}
+
+//! Inserts raw rows with `insert` and adds the inserted ones to both rollup
+//! tables in the same statement, which returns the inserted rows.
+std::string InsertWithRollups(const std::string& insert) {
+    return NCommon::Format(
+        "WITH inserted AS ({} RETURNING timestamp_ms, temperature), "
+        "hourly AS ({}), "
+        "daily AS ({}) "
+        "SELECT timestamp_ms, temperature FROM inserted",
+        insert,
+        UpsertRollups("hourly_rollups", AggregateRollups("inserted", HourMs)),
+        UpsertRollups("daily_rollups", AggregateRollups("inserted", DayMs)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Inserts of rows outside every partition fail with this.
+bool IsMissingPartition(const std::exception& ex) {
+    return std::string_view(ex.what()).find("no partition of relation") != std::string_view::npos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TPostgresTransaction
+    : public TReadingsDbTransactionBase
+{
+public:
+    TPostgresTransaction(NIpc::TTransaction tx, TPartitionManager* partitions)
+        : Tx_(std::move(tx)),
+          Partitions_(partitions)
+    {}
+
+    std::vector<TReading> WriteReadings(std::span<const TReading> readings, bool skipExisting) override {
+        try {
+            return DoWriteReadings(readings, skipExisting);
+        } catch (const std::exception& ex) {
+            // Not maintained here, this transaction holds locks the
+            // maintenance needs until it is rolled back
+            if (Partitions_ && IsMissingPartition(ex)) {
+                Partitions_->RequestMaintenance();
+            }
+            throw;
+        }
+    }
+
+    void Commit() override {
+        Tx_.Commit();
+    }
+
+private:
+    std::vector<TReading> DoWriteReadings(std::span<const TReading> readings, bool skipExisting) {
+        std::vector<std::tuple<int64_t, double>> rows;
+        rows.reserve(readings.size());
+        for (const auto& reading : readings) {
+            rows.emplace_back(ToMilliseconds(reading.timestamp), reading.temperature);
+        }
+
+        if (skipExisting) {
+            // COPY has no ON CONFLICT, the rows go through a temporary table
+            // and only the inserted ones are added to the rollups
+            Tx_.ExecuteQuery("CREATE TEMPORARY TABLE spool_replay (LIKE raw_temperatures) ON COMMIT DROP");
+            Tx_.CopyRows("spool_replay", {"timestamp_ms", "temperature"}, rows);
+            auto result = Tx_.ExecuteQuery(InsertWithRollups("INSERT INTO raw_temperatures SELECT * FROM spool_replay ON CONFLICT DO NOTHING"));
+
+            std::vector<TReading> inserted;
+            inserted.reserve(result.size());
+            for (const auto& row : result) {
+                inserted.push_back({FromMilliseconds(row[0].as<int64_t>()), row[1].as<double>()});
+            }
+            return inserted;
+        }
+
+        Tx_.CopyRows("raw_temperatures", {"timestamp_ms", "temperature"}, rows);
+
+        // Usually a single hour, grouped here instead of copying the rows twice
+        std::map<int64_t, TRollupBucket> hours;
+        for (const auto& reading : readings) {
+            hours[GetBucketStartMs(ToMilliseconds(reading.timestamp), HourMs)].Add(reading.temperature);
+        }
+        for (const auto& [startMs, hour] : hours) {
+            Tx_.ExecutePrepared(UpsertRollupsStatement, startMs, hour.Sum, static_cast<int64_t>(hour.Count), hour.Min, hour.Max);
+        }
+        return {readings.begin(), readings.end()};
+    }
+
+    NIpc::TTransaction Tx_;
+    TPartitionManager* const Partitions_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TPostgresReadingsDb::TPostgresReadingsDb(NIpc::TDataBaseConfigPtr config)
+    : Config_(config),
+      Client_(NCommon::New<NIpc::TDbClient>(config))
+{
+    Client_->Connect();
+
+    if (Config_->Partitioned) {
+        Partitions_.emplace(Client_, std::vector<TPartitionedTable>{
+            {"raw_temperatures", EPartitionPeriod::Day, std::chrono::milliseconds(RawRetentionMs)},
+            {"hourly_rollups", EPartitionPeriod::Month, std::chrono::milliseconds(HourlyRetentionMs)},
+            {"daily_rollups", EPartitionPeriod::Year, std::chrono::milliseconds(DailyRetentionMs)},
+        }, Config_->PartitionsAhead);
+    }
+}
+
+void TPostgresReadingsDb::CreateSchema(bool notifyFollowers) {
+    CreateTables();
+    CreateNotifyTriggers(notifyFollowers);
+    RegisterStatements();
+}
+
+void TPostgresReadingsDb::CreateTables() {
+    const std::string partitioning = Partitions_ ? "PARTITION BY RANGE (timestamp_ms)" : "";
+
+    Client_->ExecuteQuery(NCommon::Format(R"(
+        CREATE TABLE IF NOT EXISTS raw_temperatures (
+            timestamp_ms BIGINT PRIMARY KEY,
+            temperature DOUBLE PRECISION NOT NULL
+        ) {}
+    )", partitioning));
+
+    // Keyed by the start of the hour or day
+    for (const auto& table : {"hourly_rollups", "daily_rollups"}) {
+        Client_->ExecuteQuery(NCommon::Format(R"(
+            CREATE TABLE IF NOT EXISTS {} (
+                timestamp_ms BIGINT PRIMARY KEY,
+                sum_temperature DOUBLE PRECISION NOT NULL,
+                reading_count BIGINT NOT NULL,
+                min_temperature DOUBLE PRECISION NOT NULL,
+                max_temperature DOUBLE PRECISION NOT NULL
+            ) {}
+        )", table, partitioning));
+    }
+
+    if (Partitions_) {
+        Partitions_->Validate();
+        Partitions_->Maintain(std::nullopt);
+    }
+
+    // Superseded by the rollup statements
+    Client_->ExecuteQuery("DROP FUNCTION IF EXISTS ingest_reading(BIGINT, DOUBLE PRECISION, BOOLEAN, BOOLEAN)");
+
+    BackfillRollups("hourly_rollups", "hourly_averages", HourMs, HourlyRetentionMs);
+    BackfillRollups("daily_rollups", "daily_averages", DayMs, DailyRetentionMs);
+}
+
+void TPostgresReadingsDb::BackfillRollups(
+    const std::string& table,
+    const std::string& legacyTable,
+    int64_t periodMs,
+    int64_t retentionMs)
+{
+    auto tx = Client_->BeginTransaction();
+    if (tx.ExecuteQuery(NCommon::Format("SELECT EXISTS (SELECT 1 FROM {})", table))[0][0].as<bool>()) {
+        tx.Commit();
+        return;
+    }
+
+    tx.ExecuteQuery(UpsertRollups(table, AggregateRollups("raw_temperatures", periodMs)));
+
+    // Averages of the legacy table are stamped with the reading that closed
+    // them and cover more history than the raw rows. Each one becomes a
+    // single reading of its bucket, only for buckets before the raw rows
+    if (tx.ExecuteQuery("SELECT to_regclass($1) IS NOT NULL", legacyTable)[0][0].as<bool>()) {
+        auto legacy = NCommon::Format(
+            "(SELECT timestamp_ms, avg_temperature AS temperature FROM {} "
+            "   WHERE timestamp_ms >= (SELECT MAX(timestamp_ms) FROM {}) - {} "
+            "   AND timestamp_ms / {} * {} < (SELECT COALESCE(MIN(timestamp_ms) / {} * {}, {}) FROM raw_temperatures)"
+            ") legacy",
+            legacyTable, legacyTable, retentionMs,
+            periodMs, periodMs, periodMs, periodMs, std::numeric_limits<int64_t>::max());
+        auto result = tx.ExecuteQuery(UpsertRollups(table, AggregateRollups(legacy, periodMs)));
+        LOG_INFO("Copied {} buckets from {} into {}", result.affected_rows(), legacyTable, table);
+    }
+    tx.Commit();
+}
+
+void TPostgresReadingsDb::CreateNotifyTriggers(bool notifyFollowers) {
+    auto tx = Client_->BeginTransaction();
+    tx.ExecuteQuery("DROP TRIGGER IF EXISTS notify_followers ON raw_temperatures");
+
+    if (notifyFollowers) {
+        // One statement-level trigger call per insert, so a COPY of a batch is
+        // sent in a few notifications. Lines are "<timestamp_ms> <temperature>",
+        // followers roll them up themselves
+        tx.ExecuteQuery(NCommon::Format(R"(
+            CREATE OR REPLACE FUNCTION notify_followers() RETURNS trigger
+            LANGUAGE plpgsql AS $$
+            DECLARE
+                payload TEXT := '';
+                line TEXT;
+                r RECORD;
+            BEGIN
+                FOR r IN SELECT timestamp_ms, temperature FROM new_rows ORDER BY timestamp_ms LOOP
+                    line := r.timestamp_ms || ' ' || r.temperature || E'\n';
+                    IF length(payload) + length(line) > {} THEN
+                        PERFORM pg_notify('{}', payload);
+                        payload := '';
+                    END IF;
+                    payload := payload || line;
+                END LOOP;
+                IF payload <> '' THEN
+                    PERFORM pg_notify('{}', payload);
+                END IF;
+                RETURN NULL;
+            END;
+            $$
+        )", MaxNotifyPayload, NotifyChannel, NotifyChannel));
+
+        tx.ExecuteQuery(
+            "CREATE TRIGGER notify_followers AFTER INSERT ON raw_temperatures "
+            "REFERENCING NEW TABLE AS new_rows FOR EACH STATEMENT "
+            "EXECUTE FUNCTION notify_followers()");
+    }
+    tx.Commit();
+}
+
+void TPostgresReadingsDb::RegisterStatements() {
+    // Rollups of one hour ($1 is its start), added to the hour and to its day
+    Client_->RegisterStatement(UpsertRollupsStatement, NCommon::Format(
+        "WITH hourly AS ({}) {}",
+        UpsertRollups("hourly_rollups", "VALUES ($1::BIGINT, $2::DOUBLE PRECISION, $3::BIGINT, $4::DOUBLE PRECISION, $5::DOUBLE PRECISION)"),
+        UpsertRollups("daily_rollups", NCommon::Format("VALUES ($1::BIGINT / {} * {}, $2, $3, $4, $5)", DayMs, DayMs))));
+
+    // At most $2 oldest expired rows, the janitor repeats until fewer are left
+    auto deleteBatch = [] (const std::string& table) {
+        return NCommon::Format(
+            "DELETE FROM {} WHERE timestamp_ms IN ("
+            "   SELECT timestamp_ms FROM {} WHERE timestamp_ms < $1 ORDER BY timestamp_ms LIMIT $2"
+            ")", table, table);
+    };
+    Client_->RegisterStatement(DeleteRawStatement, deleteBatch("raw_temperatures"));
+    Client_->RegisterStatement(DeleteHourlyStatement, deleteBatch("hourly_rollups"));
+    Client_->RegisterStatement(DeleteDailyStatement, deleteBatch("daily_rollups"));
+
+    Client_->RegisterStatement(IngestReadingStatement,
+        InsertWithRollups("INSERT INTO raw_temperatures (timestamp_ms, temperature) VALUES ($1, $2)"));
+}
+
+TReadingsSnapshot TPostgresReadingsDb::LoadSnapshot(int64_t rawRetentionMs) {
+    TReadingsSnapshot snapshot{NCommon::New<TCache>(), {}, {}};
+
+    // A read-only connection, so the reload does not wait for ingestion.
+    // One snapshot for all statements, so the open rollups hold exactly the
+    // raw rows that are loaded
+    auto tx = Client_->BeginReadTransaction();
+    tx.ExecuteQuery("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ");
+
+    snapshot.Cache->rawReadings = LoadSeries(tx,
+        "raw_temperatures", "temperature", rawRetentionMs);
+    snapshot.Cache->hourlyAverages = LoadSeries(tx,
+        "hourly_rollups", "sum_temperature / reading_count", HourlyRetentionMs, true);
+    snapshot.Cache->dailyAverages = LoadSeries(tx,
+        "daily_rollups", "sum_temperature / reading_count", DailyRetentionMs, true);
+
+    auto loadOpen = [&] (const std::string& table) {
+        TRollupBucket bucket;
+        auto result = tx.ExecuteQuery(NCommon::Format(
+            "SELECT timestamp_ms, sum_temperature, reading_count, min_temperature, max_temperature "
+            "FROM {} ORDER BY timestamp_ms DESC LIMIT 1", table));
+        if (!result.empty()) {
+            bucket.Start = FromMilliseconds(result[0][0].as<int64_t>());
+            bucket.Sum = result[0][1].as<double>();
+            bucket.Count = result[0][2].as<uint64_t>();
+            bucket.Min = result[0][3].as<double>();
+            bucket.Max = result[0][4].as<double>();
+        }
+        return bucket;
+    };
+    snapshot.OpenHour = loadOpen("hourly_rollups");
+    snapshot.OpenDay = loadOpen("daily_rollups");
+
+    tx.Commit();
+    return snapshot;
+}
+
+TReadingSeries TPostgresReadingsDb::LoadSeries(
+    NIpc::TTransaction& tx,
+    const std::string& table,
+    const std::string& valueExpression,
+    int64_t retentionMs,
+    bool closedOnly)
+{
+    // Partitions keep expired rows until the whole partition expires
+    auto query = NCommon::Format(
+        "SELECT timestamp_ms, {} FROM {} WHERE timestamp_ms >= (SELECT MAX(timestamp_ms) FROM {}) - {} {} ORDER BY timestamp_ms ASC",
+        valueExpression, table, table, retentionMs,
+        closedOnly ? NCommon::Format("AND timestamp_ms < (SELECT MAX(timestamp_ms) FROM {})", table) : std::string());
+
+    TReadingSeries readings;
+    tx.StreamRows<int64_t, double>(query, [&] (int64_t timestampMs, double value) {
+        readings.push_back({FromMilliseconds(timestampMs), value});
+    });
+    return readings;
+}
+
+void TPostgresReadingsDb::IngestReading(const TReading& reading) {
+    try {
+        Client_->ExecutePrepared(IngestReadingStatement, ToMilliseconds(reading.timestamp), reading.temperature);
+    } catch (const std::exception& ex) {
+        if (!Partitions_ || !IsMissingPartition(ex)) {
+            throw;
+        }
+        LOG_WARNING("No partition for a reading, maintaining partitions: {}", ex);
+        Partitions_->RequestMaintenance();
+        Partitions_->Maintain(std::nullopt);
+        Client_->ExecutePrepared(IngestReadingStatement, ToMilliseconds(reading.timestamp), reading.temperature);
+    }
+}
+
+std::unique_ptr<TReadingsDbTransactionBase> TPostgresReadingsDb::BeginTransaction() {
+    // Runs the maintenance a failed transaction requested, before the next
+    // one takes its locks
+    TPartitionManager* partitions = Partitions_ ? &*Partitions_ : nullptr;
+    if (partitions) {
+        partitions->Maintain(std::nullopt);
+    }
+    return std::make_unique<TPostgresTransaction>(Client_->BeginTransaction(), partitions);
+}
+
+size_t TPostgresReadingsDb::RemoveExpired(std::optional<int64_t> newestMs) {
+    if (Partitions_) {
+        Partitions_->Maintain(newestMs);
+        return 0;
+    }
+    if (!newestMs) {
+        return 0;
+    }
+
+    return DeleteInBatches(DeleteRawStatement, *newestMs - RawRetentionMs)
+        + DeleteInBatches(DeleteHourlyStatement, *newestMs - HourlyRetentionMs)
+        + DeleteInBatches(DeleteDailyStatement, *newestMs - DailyRetentionMs);
+}
+
+size_t TPostgresReadingsDb::DeleteInBatches(const std::string& statement, int64_t beforeMs) {
+    const int64_t batchSize = Config_->RetentionBatchSize;
+    size_t removed = 0;
+    while (true) {
+        // Each batch commits on its own, so locks are held briefly
+        auto result = Client_->ExecutePrepared(statement, beforeMs, batchSize);
+        removed += result.affected_rows();
+        if (result.affected_rows() < batchSize) {
+            return removed;
+        }
+    }
+}
+
+TReadingSeries TPostgresReadingsDb::QueryRawRange(int64_t fromMs, int64_t toMs, size_t limit) {
+    // Newest `limit` rows by a backward scan of the primary key, returned oldest first
+    auto query = NCommon::Format(
+        "SELECT timestamp_ms, temperature FROM ("
+        "   SELECT timestamp_ms, temperature FROM raw_temperatures"
+        "   WHERE timestamp_ms >= GREATEST({}, (SELECT MAX(timestamp_ms) FROM raw_temperatures) - {})"
+        "   AND timestamp_ms < {}"
+        "   ORDER BY timestamp_ms DESC {}"
+        ") AS newest ORDER BY timestamp_ms ASC",
+        fromMs, RawRetentionMs, toMs,
+        limit == std::numeric_limits<size_t>::max() ? std::string() : NCommon::Format("LIMIT {}", limit));
+
+    TReadingSeries readings;
+    auto tx = Client_->BeginReadTransaction();
+    tx.StreamRows<int64_t, double>(query, [&] (int64_t timestampMs, double value) {
+        readings.push_back({FromMilliseconds(timestampMs), value});
+    });
+    tx.Commit();
+    return readings;
+}
+
+std::optional<std::pair<int64_t, int64_t>> TPostgresReadingsDb::GetRawBounds() {
+    // Both ends come from the primary key index
+    auto tx = Client_->BeginReadTransaction();
+    auto bounds = tx.ExecuteQuery("SELECT MIN(timestamp_ms), MAX(timestamp_ms) FROM raw_temperatures");
+    tx.Commit();
+
+    if (bounds.empty() || bounds[0][0].is_null()) {
+        return std::nullopt;
+    }
+    return std::pair(bounds[0][0].as<int64_t>(), bounds[0][1].as<int64_t>());
+}
+
+std::vector<TPyramidBucket> TPostgresReadingsDb::AggregateRaw(int64_t resolutionMs, int64_t fromMs, int64_t toMs) {
+    auto query = NCommon::Format(
+        "SELECT timestamp_ms / {} * {} AS bucket, MIN(temperature), MAX(temperature), SUM(temperature), COUNT(*)"
+        " FROM raw_temperatures WHERE timestamp_ms >= {} AND timestamp_ms < {}"
+        " GROUP BY bucket ORDER BY bucket",
+        resolutionMs, resolutionMs, fromMs, toMs);
+
+    std::vector<TPyramidBucket> buckets;
+    auto tx = Client_->BeginReadTransaction();
+    tx.StreamRows<int64_t, double, double, double, int64_t>(query,
+        [&] (int64_t startMs, double min, double max, double sum, int64_t count) {
+            buckets.push_back({FromMilliseconds(startMs), min, max, sum, static_cast<uint64_t>(count)});
+        });
+    tx.Commit();
+    return buckets;
+}
+
+std::vector<TPyramidBucket> TPostgresReadingsDb::QueryRollups(EReadingsTier tier, int64_t resolutionMs, int64_t fromMs, int64_t toMs) {
+    auto query = NCommon::Format(
+        "SELECT timestamp_ms / {} * {} AS bucket, MIN(min_temperature), MAX(max_temperature), SUM(sum_temperature), SUM(reading_count)::BIGINT"
+        " FROM {} WHERE timestamp_ms >= {} AND timestamp_ms < {}"
+        " GROUP BY bucket ORDER BY bucket",
+        resolutionMs, resolutionMs, tier == EReadingsTier::Daily ? "daily_rollups" : "hourly_rollups", fromMs, toMs);
+
+    std::vector<TPyramidBucket> buckets;
+    auto tx = Client_->BeginReadTransaction();
+    tx.StreamRows<int64_t, double, double, double, int64_t>(query,
+        [&] (int64_t startMs, double min, double max, double sum, int64_t count) {
+            buckets.push_back({FromMilliseconds(startMs), min, max, sum, static_cast<uint64_t>(count)});
+        });
+    tx.Commit();
+    return buckets;
+}
+
+NIpc::TDbListenerPtr TPostgresReadingsDb::CreateListener(
+    NIpc::TDbListener::THandler handler,
+    std::function<void()> onConnected)
+{
+    return Client_->CreateListener(NotifyChannel, std::move(handler), std::move(onConnected), ListenRetryInterval);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <service/readings_db.h>
+#include <service/partition_manager.h>
+
+#include <ipc/db_client.h>
+
+#include <optional>
+#include <string>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Tables in PostgreSQL. Writes go through the write pool, cache reloads
+//! and pushdown queries through the read-only pool and are streamed back.
+//! With `partitioned` the tables are range-partitioned by time and expired
+//! rows go away with their partition instead of being deleted.
+class TPostgresReadingsDb
+    : public TReadingsDbBase
+{
+public:
+    //! Connects the pools.
+    explicit TPostgresReadingsDb(NIpc::TDataBaseConfigPtr config);
+
+    void CreateSchema(bool notifyFollowers) override;
+    TReadingsSnapshot LoadSnapshot(int64_t rawRetentionMs) override;
+    void IngestReading(const TReading& reading) override;
+
+    std::unique_ptr<TReadingsDbTransactionBase> BeginTransaction() override;
+
+    //! Deletes at most `retention_batch_size` rows per statement, or
+    //! maintains the partitions.
+    size_t RemoveExpired(std::optional<int64_t> newestMs) override;
+
+    TReadingSeries QueryRawRange(int64_t fromMs, int64_t toMs, size_t limit) override;
+    std::optional<std::pair<int64_t, int64_t>> GetRawBounds() override;
+    std::vector<TPyramidBucket> AggregateRaw(int64_t resolutionMs, int64_t fromMs, int64_t toMs) override;
+    std::vector<TPyramidBucket> QueryRollups(EReadingsTier tier, int64_t resolutionMs, int64_t fromMs, int64_t toMs) override;
+
+    NIpc::TDbListenerPtr CreateListener(
+        NIpc::TDbListener::THandler handler,
+        std::function<void()> onConnected) override;
+
+private:
+    void CreateTables();
+
+    //! Fills an empty rollup table from the raw rows and from the averages
+    //! of `legacyTable`, which the rollups replace.
+    void BackfillRollups(const std::string& table, const std::string& legacyTable, int64_t periodMs, int64_t retentionMs);
+
+    //! With `notifyFollowers` every insert of raw rows sends them on the
+    //! notify channel, otherwise the trigger is dropped.
+    void CreateNotifyTriggers(bool notifyFollowers);
+
+    //! Prepares the statements used at ingest.
+    void RegisterStatements();
+
+    //! Deletes rows older than `beforeMs` with at most `retention_batch_size`
+    //! rows per statement.
+    size_t DeleteInBatches(const std::string& statement, int64_t beforeMs);
+
+    //! Streams the retained rows of `table` ordered by time straight into a
+    //! series, so a reload never holds the whole table as a result set.
+    //! With `closedOnly` the newest row is left out.
+    static TReadingSeries LoadSeries(
+        NIpc::TTransaction& tx,
+        const std::string& table,
+        const std::string& valueExpression,
+        int64_t retentionMs,
+        bool closedOnly = false);
+
+    NIpc::TDataBaseConfigPtr Config_;
+    NIpc::TDbClientPtr Client_;
+
+    //! Set with `partitioned`, replaces row deletes.
+    std::optional<TPartitionManager> Partitions_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,270 @@
+#include <service/pyramid.h>
+
+#include <common/exception.h>
+#include <common/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "Pyramid";
+
+constexpr char StateMagic[8] = {'T', 'M', 'P', 'P', 'Y', 'R', 'M', 'D'};
+constexpr uint32_t StateVersion = 1;
+
+//! Bucket layout in the state file.
+struct TBucketRecord {
+    int64_t StartMs;
+    double Min;
+    double Max;
+    double Sum;
+    uint64_t Count;
+};
+
+static_assert(sizeof(TBucketRecord) == 40);
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::floor<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromMilliseconds(int64_t timestampMs) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs));
+}
+
+std::chrono::system_clock::time_point AlignDown(std::chrono::system_clock::time_point timestamp, std::chrono::milliseconds resolution) {
+    int64_t ms = ToMilliseconds(timestamp);
+    int64_t step = resolution.count();
+    int64_t aligned = ms - ((ms % step) + step) % step;
+
+    // Buckets of the earliest representable times start before the clock range
+    const int64_t minMs = std::chrono::ceil<std::chrono::milliseconds>(
+        std::chrono::system_clock::time_point::min().time_since_epoch()).count();
+    return aligned < minMs ? std::chrono::system_clock::time_point::min() : FromMilliseconds(aligned);
+}
+
+TPyramidBucket MakeBucket(std::chrono::system_clock::time_point start, double value) {
+    return {start, value, value, value, 1};
+}
+
+template <typename T>
+void WritePod(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T ReadPod(std::istream& in) {
+    T value;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    ASSERT(in.gcount() == sizeof(value), "Unexpected end of file");
+    return value;
+}
+
+void WriteBucket(std::ostream& out, const TPyramidBucket& bucket) {
+    WritePod(out, TBucketRecord{ToMilliseconds(bucket.Start), bucket.Min, bucket.Max, bucket.Sum, bucket.Count});
+}
+
+TPyramidBucket ReadBucket(std::istream& in) {
+    auto record = ReadPod<TBucketRecord>(in);
+    return {FromMilliseconds(record.StartMs), record.Min, record.Max, record.Sum, record.Count};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<TPyramidLevelConfig>& TPyramid::GetDefaultLevels() {
+    using namespace std::chrono_literals;
+    static const std::vector<TPyramidLevelConfig> levels = {
+        {1min, 24h},
+        {10min, 7 * 24h},
+        {1h, 30 * 24h},
+        {24h, 360 * 24h},
+    };
+    return levels;
+}
+
+TPyramid::TPyramid()
+    : TPyramid(GetDefaultLevels())
+{}
+
+TPyramid::TPyramid(const std::vector<TPyramidLevelConfig>& levels) {
+    for (const auto& config : levels) {
+        ASSERT(config.Resolution.count() > 0, "Pyramid resolution must be positive");
+        Levels_.push_back({config, {}, {}, {}});
+    }
+}
+
+void TPyramid::Add(const TReading& reading) {
+    LastTimestamp_ = std::max(LastTimestamp_.value_or(reading.timestamp), reading.timestamp);
+
+    for (auto& level : Levels_) {
+        auto start = AlignDown(reading.timestamp, level.Config.Resolution);
+
+        if (!level.Open) {
+            level.Open = MakeBucket(start, reading.temperature);
+        } else if (level.Open->Start == start) {
+            auto& bucket = *level.Open;
+            bucket.Min = std::min(bucket.Min, reading.temperature);
+            bucket.Max = std::max(bucket.Max, reading.temperature);
+            bucket.Sum += reading.temperature;
+            bucket.Count++;
+        } else if (level.Open->Start < start) {
+            level.Sealed.push_back(*level.Open);
+            level.Open = MakeBucket(start, reading.temperature);
+        }
+
+        const auto expired = reading.timestamp - level.Config.Retention;
+        while (!level.Sealed.empty() && level.Sealed.front().Start + level.Config.Resolution <= expired) {
+            level.DroppedBefore = level.Sealed.front().Start + level.Config.Resolution;
+            level.Sealed.pop_front();
+        }
+    }
+}
+
+std::optional<TPyramidSlice> TPyramid::Query(
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t minPoints) const
+{
+    std::optional<TPyramidSlice> coarser;
+
+    for (auto level = Levels_.rbegin(); level != Levels_.rend(); ++level) {
+        // A finer level that has already dropped part of the range would
+        // truncate it, fewer points of a coarser level are better then.
+        bool covers = !level->DroppedBefore || from >= *level->DroppedBefore;
+        if (coarser && !covers) {
+            return coarser;
+        }
+
+        const auto& sealed = level->Sealed;
+        const auto first = from == std::chrono::system_clock::time_point::min()
+            ? from
+            : AlignDown(from, level->Config.Resolution);
+
+        auto begin = std::partition_point(sealed.begin(), sealed.end(), [&] (const TPyramidBucket& bucket) {
+            return bucket.Start < first;
+        });
+        auto end = std::partition_point(begin, sealed.end(), [&] (const TPyramidBucket& bucket) {
+            return bucket.Start < to;
+        });
+
+        bool withOpen = level->Open && level->Open->Start >= first && level->Open->Start < to;
+        size_t count = static_cast<size_t>(end - begin) + (withOpen ? 1 : 0);
+        if (count == 0) {
+            continue;
+        }
+
+        TPyramidSlice slice{level->Config.Resolution, {}};
+        slice.Buckets.reserve(count);
+        slice.Buckets.insert(slice.Buckets.end(), begin, end);
+        if (withOpen) {
+            slice.Buckets.push_back(*level->Open);
+        }
+
+        if (count >= minPoints) {
+            return slice;
+        }
+        coarser = std::move(slice);
+    }
+    return std::nullopt;
+}
+
+std::optional<std::chrono::system_clock::time_point> TPyramid::GetLastTimestamp() const {
+    return LastTimestamp_;
+}
+
+void TPyramid::Save(const std::filesystem::path& path) const {
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+
+    try {
+        {
+            std::ofstream fout(tmpPath, std::ios::out | std::ios::trunc | std::ios::binary);
+            fout.write(StateMagic, sizeof(StateMagic));
+            WritePod(fout, StateVersion);
+            WritePod<int64_t>(fout, LastTimestamp_ ? ToMilliseconds(*LastTimestamp_) : 0);
+            WritePod<uint8_t>(fout, LastTimestamp_.has_value());
+            WritePod<uint32_t>(fout, Levels_.size());
+
+            for (const auto& level : Levels_) {
+                WritePod<int64_t>(fout, level.Config.Resolution.count());
+                WritePod<uint64_t>(fout, level.Sealed.size());
+                for (const auto& bucket : level.Sealed) {
+                    WriteBucket(fout, bucket);
+                }
+                WritePod<uint8_t>(fout, level.Open.has_value());
+                if (level.Open) {
+                    WriteBucket(fout, *level.Open);
+                }
+                WritePod<uint8_t>(fout, level.DroppedBefore.has_value());
+                WritePod<int64_t>(fout, level.DroppedBefore ? ToMilliseconds(*level.DroppedBefore) : 0);
+            }
+            ASSERT(fout.good(), "Failed to write {}", tmpPath);
+        }
+        std::filesystem::rename(tmpPath, path);
+    } catch (std::exception& ex) {
+        LOG_WARNING("Failed to save pyramid (File: {}, Exception: {})", path, ex);
+    }
+}
+
+bool TPyramid::Load(const std::filesystem::path& path) {
+    if (!std::filesystem::exists(path)) {
+        return false;
+    }
+
+    auto levels = Levels_;
+    try {
+        std::ifstream fin(path, std::ios::in | std::ios::binary);
+
+        char magic[sizeof(StateMagic)];
+        fin.read(magic, sizeof(magic));
+        ASSERT(fin && std::memcmp(magic, StateMagic, sizeof(magic)) == 0, "Not a pyramid state file");
+        ASSERT(ReadPod<uint32_t>(fin) == StateVersion, "Unsupported pyramid state version");
+
+        auto lastMs = ReadPod<int64_t>(fin);
+        bool hasLast = ReadPod<uint8_t>(fin);
+        ASSERT(ReadPod<uint32_t>(fin) == levels.size(), "Pyramid levels changed");
+
+        for (auto& level : levels) {
+            ASSERT(ReadPod<int64_t>(fin) == level.Config.Resolution.count(), "Pyramid levels changed");
+            level.Sealed.clear();
+            level.Open.reset();
+
+            auto count = ReadPod<uint64_t>(fin);
+            for (uint64_t i = 0; i < count; i++) {
+                level.Sealed.push_back(ReadBucket(fin));
+            }
+            if (ReadPod<uint8_t>(fin)) {
+                level.Open = ReadBucket(fin);
+            }
+            bool dropped = ReadPod<uint8_t>(fin);
+            auto droppedBeforeMs = ReadPod<int64_t>(fin);
+            level.DroppedBefore.reset();
+            if (dropped) {
+                level.DroppedBefore = FromMilliseconds(droppedBeforeMs);
+            }
+        }
+
+        Levels_ = std::move(levels);
+        LastTimestamp_.reset();
+        if (hasLast) {
+            LastTimestamp_ = FromMilliseconds(lastMs);
+        }
+        return true;
+    } catch (std::exception& ex) {
+        LOG_WARNING("Failed to load pyramid (File: {}, Exception: {})", path, ex);
+        return false;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
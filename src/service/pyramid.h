@@ -0,0 +1,88 @@
+#pragma once
+
+#include <service/reading.h>
+#include <service/series.h>
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Aggregate of readings in [Start, Start + resolution).
+struct TPyramidBucket {
+    std::chrono::system_clock::time_point Start;
+    double Min;
+    double Max;
+    double Sum;
+    uint64_t Count;
+
+    double GetAverage() const {
+        return Sum / Count;
+    }
+};
+
+struct TPyramidLevelConfig {
+    std::chrono::milliseconds Resolution;
+    std::chrono::milliseconds Retention;
+};
+
+//! Buckets of a single level covering a queried range, oldest first.
+struct TPyramidSlice {
+    std::chrono::milliseconds Resolution;
+    std::vector<TPyramidBucket> Buckets;
+};
+
+//! Multi-resolution min/max/sum/count buckets updated at ingest.
+//! Buckets are aligned to multiples of the level resolution since epoch.
+//! Like the series it is built from, a copy is O(number of levels) and
+//! copies share sealed buckets.
+class TPyramid {
+public:
+    //! 1 min for a day, 10 min for a week, 1 h for 30 days, 1 d for 360 days.
+    static const std::vector<TPyramidLevelConfig>& GetDefaultLevels();
+
+    TPyramid();
+    explicit TPyramid(const std::vector<TPyramidLevelConfig>& levels);
+
+    //! Readings older than the open bucket of a level are not counted in it.
+    void Add(const TReading& reading);
+
+    //! Buckets overlapping [from, to) from the coarsest level that has at
+    //! least `minPoints` of them. Levels whose retention does not cover `from`
+    //! are not used when a coarser level has some buckets. Returns nullopt if
+    //! even the finest level has fewer buckets, raw readings fit better then.
+    std::optional<TPyramidSlice> Query(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t minPoints) const;
+
+    std::optional<std::chrono::system_clock::time_point> GetLastTimestamp() const;
+
+    //! Atomically replaces the state file.
+    void Save(const std::filesystem::path& path) const;
+
+    //! Returns false and leaves the pyramid unchanged if the file is missing,
+    //! corrupted or was written with other levels.
+    bool Load(const std::filesystem::path& path);
+
+private:
+    struct TLevel {
+        TPyramidLevelConfig Config;
+        TChunkedSeries<TPyramidBucket> Sealed;
+        std::optional<TPyramidBucket> Open;
+
+        //! Readings before this point were dropped by retention.
+        std::optional<std::chrono::system_clock::time_point> DroppedBefore;
+    };
+
+    std::vector<TLevel> Levels_;
+    std::optional<std::chrono::system_clock::time_point> LastTimestamp_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
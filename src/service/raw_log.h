@@ -0,0 +1,34 @@
+#pragma once
+
+#include <service/storage.h>
+
+#include <chrono>
+#include <span>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Persistent storage of raw readings used by TFileStorage.
+class TRawLogBase {
+public:
+    virtual ~TRawLogBase() = default;
+
+    //! Reads all persisted readings, oldest first.
+    virtual TReadingSeries ReadAll() const = 0;
+
+    //! Appends readings in timestamp order. Appended data may stay in OS
+    //! buffers until Sync.
+    virtual void Append(std::span<const TReading> readings) = 0;
+
+    //! Forces appended readings to stable storage.
+    virtual void Sync() = 0;
+
+    //! Drops readings older than `timestamp`, implementations may keep some
+    //! of them if they can only drop data in larger units.
+    virtual void DropBefore(std::chrono::system_clock::time_point timestamp) = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
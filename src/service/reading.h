@@ -0,0 +1,12 @@
+#pragma once
+
+#include <chrono>
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TReading {
+    std::chrono::system_clock::time_point timestamp;
+    double temperature;
+};
+
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,131 @@
+#include <service/reading_spool.h>
+#include <service/readings_io.h>
+
+#include <common/logging.h>
+#include <common/exception.h>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "Spool";
+
+// Exact values, the readings are replayed as they came
+const NConfig::TReadingsFormat SpoolFormat = {NConfig::EFileFormat::Binary, NConfig::EValueEncoding::Double};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TReadingSpool::TReadingSpool(std::filesystem::path path)
+    : Path_(std::move(path)),
+      ReplayPath_(Path_.string() + ".replay")
+{
+    if (Path_.has_parent_path()) {
+        std::filesystem::create_directories(Path_.parent_path());
+    }
+
+    if (std::filesystem::exists(ReplayPath_)) {
+        Replaying_ = ReadingsFromFile(ReplayPath_).size();
+        if (Replaying_ == 0) {
+            std::filesystem::remove(ReplayPath_);
+        }
+    }
+
+    Appended_ = RewriteFile();
+
+    if (Size() > 0) {
+        LOG_INFO("Found {} spooled readings in {}", Size(), Path_);
+    }
+}
+
+void TReadingSpool::OpenFile() {
+    bool fresh = !std::filesystem::exists(Path_) || std::filesystem::file_size(Path_) == 0;
+    Out_.open(Path_, std::ios::out | std::ios::binary | std::ios::app);
+    ASSERT(Out_.is_open(), "Failed to open spool {}", Path_);
+    if (fresh) {
+        WriteFileHeader(Out_, SpoolFormat);
+    }
+}
+
+size_t TReadingSpool::RewriteFile() {
+    if (!std::filesystem::exists(Path_)) {
+        return 0;
+    }
+
+    auto readings = ReadingsFromFile(Path_);
+    if (readings.empty()) {
+        std::filesystem::remove(Path_);
+    } else {
+        ReadingsToFile(Path_, readings, SpoolFormat);
+    }
+    return readings.size();
+}
+
+void TReadingSpool::Append(std::span<const TReading> readings) {
+    auto guard = std::lock_guard(Mutex_);
+
+    if (!Out_.is_open()) {
+        OpenFile();
+    }
+    AppendReadings(Out_, readings, SpoolFormat);
+    Out_.flush();
+
+    if (!Out_.good()) {
+        // A failed stream drops every later write, the file is reopened by
+        // the next append instead
+        Out_.close();
+        Out_.clear();
+        try {
+            Appended_ = RewriteFile();
+        } catch (const std::exception& ex) {
+            LOG_ERROR("Failed to repair spool {}: {}", Path_, ex);
+        }
+        THROW("Failed to append {} readings to spool {}", readings.size(), Path_);
+    }
+
+    Appended_ += readings.size();
+}
+
+size_t TReadingSpool::Size() const {
+    auto guard = std::lock_guard(Mutex_);
+    return Appended_ + Replaying_;
+}
+
+bool TReadingSpool::Empty() const {
+    return Size() == 0;
+}
+
+TReadingSeries TReadingSpool::TakeReplay() {
+    {
+        auto guard = std::lock_guard(Mutex_);
+
+        if (Replaying_ == 0) {
+            if (Appended_ == 0) {
+                return {};
+            }
+
+            Out_.close();
+            std::filesystem::rename(Path_, ReplayPath_);
+            Replaying_ = std::exchange(Appended_, 0);
+        }
+    }
+
+    // Appends go to the other file, so the replay is read without the lock
+    return ReadingsFromFile(ReplayPath_);
+}
+
+void TReadingSpool::CommitReplay() {
+    auto guard = std::lock_guard(Mutex_);
+
+    std::filesystem::remove(ReplayPath_);
+    Replaying_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
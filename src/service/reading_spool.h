@@ -0,0 +1,56 @@
+#pragma once
+
+#include <service/storage.h>
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Append-only file of readings waiting to be written to a storage that is
+//! unavailable. A replay takes the whole file over as `<path>.replay`, so
+//! appends go on into a fresh file meanwhile; the replay file is removed
+//! once all of it is written. An unfinished replay is picked up on restart.
+class TReadingSpool {
+public:
+    explicit TReadingSpool(std::filesystem::path path);
+
+    //! Appends readings and flushes them to the OS.
+    void Append(std::span<const TReading> readings);
+
+    //! Readings appended and not yet replayed.
+    size_t Size() const;
+    bool Empty() const;
+
+    //! Readings of the unfinished replay, or of the current file, which
+    //! then becomes the replay. Oldest first.
+    TReadingSeries TakeReplay();
+
+    //! Removes the replay file once its readings are written.
+    void CommitReplay();
+
+private:
+    void OpenFile();
+
+    //! Rewrites the current file with the readings it holds in full, so
+    //! appends do not land behind a torn block. Returns how many there are.
+    size_t RewriteFile();
+
+    mutable std::mutex Mutex_;
+
+    const std::filesystem::path Path_;
+    const std::filesystem::path ReplayPath_;
+
+    std::ofstream Out_;
+
+    size_t Appended_ = 0;
+    size_t Replaying_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,118 @@
+#include <service/readings_cache.h>
+
+#include <algorithm>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+//! A new cache with the series of `cache`, for copy-on-write.
+TCachePtr CopySeries(const TCache& cache) {
+    TCachePtr newCache = NCommon::New<TCache>();
+    newCache->rawReadings = cache.rawReadings;
+    newCache->hourlyAverages = cache.hourlyAverages;
+    newCache->dailyAverages = cache.dailyAverages;
+    return newCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TReadingsCache::TReadingsCache()
+    : Cache_(NCommon::New<TCache>())
+{}
+
+TCachePtr TReadingsCache::Acquire() const {
+    return Cache_.Acquire();
+}
+
+void TReadingsCache::Load(TReadingsSnapshot snapshot) {
+    if (!Pyramid_.GetLastTimestamp()) {
+        for (const auto& reading : snapshot.Cache->rawReadings) {
+            Pyramid_.Add(reading);
+        }
+    }
+    snapshot.Cache->pyramid = Pyramid_;
+
+    Cache_.Store(snapshot.Cache);
+    OpenHour_ = snapshot.OpenHour;
+    OpenDay_ = snapshot.OpenDay;
+}
+
+void TReadingsCache::AddToPyramid(const TReading& reading) {
+    Pyramid_.Add(reading);
+}
+
+bool TReadingsCache::Append(std::span<const TReading> readings) {
+    TCachePtr currentCache = Cache_.Acquire();
+
+    bool ordered = std::is_sorted(readings.begin(), readings.end(), [] (const TReading& lhs, const TReading& rhs) {
+        return lhs.timestamp < rhs.timestamp;
+    });
+    if (!ordered
+        || (!readings.empty() && !currentCache->rawReadings.empty()
+            && readings.front().timestamp <= currentCache->rawReadings.back().timestamp))
+    {
+        return false;
+    }
+
+    // Expired rows are left to the janitor
+    TCachePtr newCache = CopySeries(*currentCache);
+    for (const auto& reading : readings) {
+        newCache->rawReadings.push_back(reading);
+        AdvanceRollups(*newCache, reading);
+    }
+
+    newCache->pyramid = Pyramid_;
+    Cache_.Store(newCache);
+    return true;
+}
+
+std::optional<int64_t> TReadingsCache::Trim(int64_t cachedRawMs) {
+    TCachePtr currentCache = Cache_.Acquire();
+    if (currentCache->rawReadings.empty()) {
+        return std::nullopt;
+    }
+
+    const auto newest = currentCache->rawReadings.back().timestamp;
+
+    TCachePtr newCache = CopySeries(*currentCache);
+    newCache->pyramid = currentCache->pyramid;
+
+    newCache->rawReadings.DropBefore(newest - std::chrono::milliseconds(cachedRawMs));
+    newCache->hourlyAverages.DropBefore(newest - std::chrono::milliseconds(HourlyRetentionMs));
+    newCache->dailyAverages.DropBefore(newest - std::chrono::milliseconds(DailyRetentionMs));
+    Cache_.Store(newCache);
+
+    return ToMilliseconds(newest);
+}
+
+void TReadingsCache::AdvanceRollups(TCache& cache, const TReading& reading) {
+    const int64_t timestampMs = ToMilliseconds(reading.timestamp);
+    auto advance = [&] (TRollupBucket& bucket, TReadingSeries& averages, int64_t periodMs) {
+        const auto start = std::chrono::system_clock::time_point(
+            std::chrono::milliseconds(GetBucketStartMs(timestampMs, periodMs)));
+        if (!bucket.Start) {
+            bucket.Reset(start);
+        } else if (*bucket.Start < start) {
+            averages.push_back({*bucket.Start, bucket.GetAverage()});
+            bucket.Reset(start);
+        }
+        bucket.Add(reading.temperature);
+    };
+    advance(OpenHour_, cache.hourlyAverages, HourMs);
+    advance(OpenDay_, cache.dailyAverages, DayMs);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <service/readings_db.h>
+
+#include <common/atomic_intrusive_ptr.h>
+
+#include <optional>
+#include <span>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Copy-on-write cache of the raw, hourly and daily tables of a storage:
+//! readers acquire an immutable TCache, every write publishes a new one.
+//! Hourly and daily averages are cached once a reading of a later bucket
+//! closes their rollup. Writers are serialized by the storage.
+class TReadingsCache {
+public:
+    TReadingsCache();
+
+    TCachePtr Acquire() const;
+
+    //! Replaces the series with a reload. The pyramid is built from the raw
+    //! readings of the first load, later it keeps what was added to it.
+    void Load(TReadingsSnapshot snapshot);
+
+    //! Counts a written reading in the pyramid, published with the next
+    //! Append or Load.
+    void AddToPyramid(const TReading& reading);
+
+    //! Appends readings ordered by time and newer than every cached one,
+    //! advancing the open rollups. Returns false without changes otherwise,
+    //! only a reload places such readings.
+    bool Append(std::span<const TReading> readings);
+
+    //! Drops cached rows expired relative to the newest raw reading, raw
+    //! ones older than `cachedRawMs`. Returns the newest raw timestamp,
+    //! nullopt if nothing is cached.
+    std::optional<int64_t> Trim(int64_t cachedRawMs);
+
+private:
+    //! Closes the open rollups the reading is past and adds it to the open ones.
+    void AdvanceRollups(TCache& cache, const TReading& reading);
+
+    NCommon::TAtomicIntrusivePtr<TCache> Cache_;
+
+    //! Built from cached raw readings on startup, updated at ingest.
+    TPyramid Pyramid_;
+
+    //! The newest rollups in the database, loaded with the cache.
+    TRollupBucket OpenHour_;
+    TRollupBucket OpenDay_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <service/storage.h>
+#include <service/rollup_engine.h>
+
+#include <ipc/db_listener.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Rollups are hours and days (UTC) since epoch, stamped with their start.
+//! Rows of a table are kept for its retention, counted back from the newest row.
+inline constexpr int64_t HourMs = 3600ll * 1000ll;
+inline constexpr int64_t DayMs = 24 * HourMs;
+
+inline constexpr int64_t RawRetentionMs = DayMs;
+inline constexpr int64_t HourlyRetentionMs = 30 * DayMs;
+inline constexpr int64_t DailyRetentionMs = 365 * DayMs;
+
+inline int64_t GetBucketStartMs(int64_t timestampMs, int64_t periodMs) {
+    return timestampMs / periodMs * periodMs;
+}
+
+//! What a reload reads, in one snapshot.
+struct TReadingsSnapshot {
+    //! Averages of the closed rollups, the pyramid is left empty.
+    TCachePtr Cache;
+
+    //! The newest rollups, they hold the newest raw reading and stay open
+    //! until a reading of a later hour or day arrives.
+    TRollupBucket OpenHour;
+    TRollupBucket OpenDay;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Writes of one transaction of TReadingsDbBase, rolled back on destruction
+//! unless committed.
+class TReadingsDbTransactionBase {
+public:
+    virtual ~TReadingsDbTransactionBase() = default;
+
+    //! Inserts raw readings and adds them to the sum, count, min and max of
+    //! their hourly and daily rollups. With `skipExisting` readings whose
+    //! timestamp is already stored are skipped and not counted again,
+    //! otherwise they fail the transaction. Returns the inserted readings.
+    virtual std::vector<TReading> WriteReadings(std::span<const TReading> readings, bool skipExisting) = 0;
+
+    virtual void Commit() = 0;
+};
+
+//! The raw, hourly and daily tables behind TDataBaseStorage: one method per
+//! statement the storage issues, so its logic runs the same against
+//! PostgreSQL and against the in-memory tables used by the benchmarks.
+//! Methods throw if the database fails.
+class TReadingsDbBase {
+public:
+    virtual ~TReadingsDbBase() = default;
+
+    //! Creates the tables and the statements used at ingest. Only the writer
+    //! calls it, `notifyFollowers` installs the trigger followers listen to.
+    virtual void CreateSchema(bool notifyFollowers) = 0;
+
+    //! Retained rows of every table ordered by time, raw rows only within
+    //! `rawRetentionMs`.
+    virtual TReadingsSnapshot LoadSnapshot(int64_t rawRetentionMs) = 0;
+
+    //! WriteReadings of a single reading in one round trip.
+    virtual void IngestReading(const TReading& reading) = 0;
+
+    virtual std::unique_ptr<TReadingsDbTransactionBase> BeginTransaction() = 0;
+
+    //! Deletes the rows expired relative to `newestMs`, returns how many.
+    //! Without rows in the cache `newestMs` is not known.
+    virtual size_t RemoveExpired(std::optional<int64_t> newestMs) = 0;
+
+    //! Raw rows in [fromMs, toMs), the newest `limit` of them oldest first.
+    virtual TReadingSeries QueryRawRange(int64_t fromMs, int64_t toMs, size_t limit) = 0;
+
+    //! Oldest and newest raw timestamps, nullopt if the table is empty.
+    virtual std::optional<std::pair<int64_t, int64_t>> GetRawBounds() = 0;
+
+    //! Raw rows in [fromMs, toMs) grouped into buckets aligned to multiples
+    //! of `resolutionMs`, ordered by time.
+    virtual std::vector<TPyramidBucket> AggregateRaw(int64_t resolutionMs, int64_t fromMs, int64_t toMs) = 0;
+
+    //! Hourly or daily rollups starting in [fromMs, toMs) merged into buckets
+    //! aligned to `resolutionMs`, a multiple of their period, ordered by time.
+    virtual std::vector<TPyramidBucket> QueryRollups(EReadingsTier tier, int64_t resolutionMs, int64_t fromMs, int64_t toMs) = 0;
+
+    //! Listener for the raw rows inserted by a writer with `notifyFollowers`,
+    //! not started yet. See NIpc::TDbListener.
+    virtual NIpc::TDbListenerPtr CreateListener(
+        NIpc::TDbListener::THandler handler,
+        std::function<void()> onConnected) = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
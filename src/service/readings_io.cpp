@@ -0,0 +1,528 @@
+#include <service/readings_io.h>
+
+#include <common/exception.h>
+#include <common/logging.h>
+#include <common/threadpool.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "ReadingsIO";
+
+// Binary files are written in host byte order:
+//   file header | block | block | ...
+//   block = block header | Count records of (int64 timestamp ms, value)
+// An append writes a new block or adds records to the last one and then
+// updates its count, so a crash can only lose the last append.
+
+constexpr char BinaryMagic[8] = {'T', 'M', 'P', 'R', 'E', 'A', 'D', 'S'};
+constexpr uint32_t BinaryVersion = 1;
+constexpr uint16_t BlockVersion = 1;
+
+struct TFileHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t Reserved;
+};
+
+struct TBlockHeader {
+    uint16_t Version;
+    uint16_t Encoding;
+    uint32_t Count;
+};
+
+static_assert(sizeof(TFileHeader) == 16);
+static_assert(sizeof(TBlockHeader) == 8);
+
+//! Fixed-point values are stored in thousandths of a degree.
+constexpr double FixedPointScale = 1000;
+
+size_t GetValueSize(NConfig::EValueEncoding encoding) {
+    switch (encoding) {
+        case NConfig::EValueEncoding::Double:
+            return sizeof(double);
+        case NConfig::EValueEncoding::Float:
+            return sizeof(float);
+        case NConfig::EValueEncoding::FixedPoint:
+            return sizeof(int32_t);
+    }
+    THROW("Unknown value encoding {}", static_cast<int>(encoding));
+}
+
+void EncodeValue(char* out, double value, NConfig::EValueEncoding encoding) {
+    switch (encoding) {
+        case NConfig::EValueEncoding::Double:
+            std::memcpy(out, &value, sizeof(value));
+            return;
+        case NConfig::EValueEncoding::Float: {
+            float encoded = static_cast<float>(value);
+            std::memcpy(out, &encoded, sizeof(encoded));
+            return;
+        }
+        case NConfig::EValueEncoding::FixedPoint: {
+            int32_t encoded = static_cast<int32_t>(std::lround(value * FixedPointScale));
+            std::memcpy(out, &encoded, sizeof(encoded));
+            return;
+        }
+    }
+}
+
+double DecodeValue(const char* in, NConfig::EValueEncoding encoding) {
+    switch (encoding) {
+        case NConfig::EValueEncoding::Double: {
+            double value;
+            std::memcpy(&value, in, sizeof(value));
+            return value;
+        }
+        case NConfig::EValueEncoding::Float: {
+            float value;
+            std::memcpy(&value, in, sizeof(value));
+            return value;
+        }
+        case NConfig::EValueEncoding::FixedPoint: {
+            int32_t value;
+            std::memcpy(&value, in, sizeof(value));
+            return value / FixedPointScale;
+        }
+    }
+    THROW("Unknown value encoding {}", static_cast<int>(encoding));
+}
+
+//! Fixed point holds only finite values within int32 range, blocks with
+//! other values are written as doubles.
+NConfig::EValueEncoding GetBlockEncoding(std::span<const TReading> readings, NConfig::EValueEncoding encoding) {
+    if (encoding != NConfig::EValueEncoding::FixedPoint) {
+        return encoding;
+    }
+
+    constexpr double MaxFixedPoint = std::numeric_limits<int32_t>::max() / FixedPointScale;
+    constexpr double MinFixedPoint = std::numeric_limits<int32_t>::min() / FixedPointScale;
+    bool fits = std::all_of(readings.begin(), readings.end(), [&] (const TReading& reading) {
+        return std::isfinite(reading.temperature)
+            && reading.temperature >= MinFixedPoint && reading.temperature <= MaxFixedPoint;
+    });
+    return fits ? encoding : NConfig::EValueEncoding::Double;
+}
+
+bool IsValueEncoding(uint16_t encoding) {
+    return encoding <= static_cast<uint16_t>(NConfig::EValueEncoding::FixedPoint);
+}
+
+TReadingSeries ReadingsFromBinaryFile(const std::filesystem::path& file) {
+    std::ifstream fin(file, std::ios::in | std::ios::binary);
+    std::vector<char> buffer(std::filesystem::file_size(file));
+    fin.read(buffer.data(), buffer.size());
+    ASSERT(fin.gcount() == static_cast<std::streamsize>(buffer.size()), "Failed to read {}", file);
+
+    TFileHeader header;
+    ASSERT(buffer.size() >= sizeof(header), "File is too small for the header");
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    ASSERT(header.Version == BinaryVersion, "Unsupported binary file version {}", header.Version);
+
+    TReadingSeries data;
+    size_t offset = sizeof(header);
+    while (offset < buffer.size()) {
+        TBlockHeader block;
+        if (buffer.size() - offset < sizeof(block)) {
+            LOG_WARNING("Truncated block header in {} at offset {}", file, offset);
+            break;
+        }
+        std::memcpy(&block, buffer.data() + offset, sizeof(block));
+
+        if (block.Version != BlockVersion || !IsValueEncoding(block.Encoding)) {
+            LOG_WARNING("Unsupported block in {} at offset {} (Version: {}, Encoding: {})", file, offset, block.Version, block.Encoding);
+            break;
+        }
+
+        auto encoding = static_cast<NConfig::EValueEncoding>(block.Encoding);
+        size_t recordSize = sizeof(int64_t) + GetValueSize(encoding);
+        if ((buffer.size() - offset - sizeof(block)) / recordSize < block.Count) {
+            LOG_WARNING("Truncated block in {} at offset {}", file, offset);
+            break;
+        }
+        offset += sizeof(block);
+
+        for (uint32_t i = 0; i < block.Count; i++, offset += recordSize) {
+            int64_t timestampMs;
+            std::memcpy(&timestampMs, buffer.data() + offset, sizeof(timestampMs));
+            data.push_back({
+                std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs)),
+                DecodeValue(buffer.data() + offset + sizeof(timestampMs), encoding)
+            });
+        }
+    }
+    return data;
+}
+
+//! Text files smaller than this are parsed on the calling thread.
+constexpr size_t ParallelChunkSize = 1 << 20;
+
+//! Read-only mapping of a whole file.
+class TMappedFile {
+public:
+    explicit TMappedFile(const std::filesystem::path& file) {
+        int fd = open(file.c_str(), O_RDONLY);
+        ASSERT(fd >= 0, "Failed to open {}: {}", file, std::strerror(errno));
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            int error = errno;
+            close(fd);
+            THROW("Failed to stat {}: {}", file, std::strerror(error));
+        }
+
+        Size_ = st.st_size;
+        if (Size_ > 0) {
+            Data_ = mmap(nullptr, Size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+
+        ASSERT(Data_ != MAP_FAILED, "Failed to map {}: {}", file, std::strerror(errno));
+        if (Data_) {
+            madvise(Data_, Size_, MADV_SEQUENTIAL);
+        }
+    }
+
+    ~TMappedFile() {
+        if (Data_ && Data_ != MAP_FAILED) {
+            munmap(Data_, Size_);
+        }
+    }
+
+    TMappedFile(const TMappedFile&) = delete;
+    TMappedFile& operator=(const TMappedFile&) = delete;
+
+    const char* GetData() const {
+        return static_cast<const char*>(Data_);
+    }
+
+    size_t GetSize() const {
+        return Size_;
+    }
+
+private:
+    void* Data_ = nullptr;
+    size_t Size_ = 0;
+};
+
+bool ParseDigits(const char* str, int count, int& value) {
+    value = 0;
+    for (int i = 0; i < count; i++) {
+        if (str[i] < '0' || str[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (str[i] - '0');
+    }
+    return true;
+}
+
+//! Parses 'YYYY-MM-DDTHH:MM:SS[.mmm]Z <value>' without locale or stream machinery.
+bool TryParseReading(const char* begin, const char* end, TReading& reading) {
+    constexpr size_t TimestampLength = 20;
+    constexpr size_t MillisecondsLength = 4;
+    if (end - begin < static_cast<std::ptrdiff_t>(TimestampLength)) {
+        return false;
+    }
+
+    int year, month, day, hour, minute, second;
+    bool ok = ParseDigits(begin, 4, year) && begin[4] == '-'
+        && ParseDigits(begin + 5, 2, month) && begin[7] == '-'
+        && ParseDigits(begin + 8, 2, day) && begin[10] == 'T'
+        && ParseDigits(begin + 11, 2, hour) && begin[13] == ':'
+        && ParseDigits(begin + 14, 2, minute) && begin[16] == ':'
+        && ParseDigits(begin + 17, 2, second);
+    if (!ok) {
+        return false;
+    }
+
+    int millisecond = 0;
+    size_t timestampLength = TimestampLength;
+    if (begin[19] == '.') {
+        timestampLength += MillisecondsLength;
+        ok = end - begin >= static_cast<std::ptrdiff_t>(timestampLength)
+            && ParseDigits(begin + 20, 3, millisecond);
+        if (!ok) {
+            return false;
+        }
+    }
+    if (begin[timestampLength - 1] != 'Z') {
+        return false;
+    }
+
+    std::chrono::year_month_day date{std::chrono::year(year), std::chrono::month(month), std::chrono::day(day)};
+    if (!date.ok() || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    const char* value = begin + timestampLength;
+    while (value != end && (*value == ' ' || *value == '\t')) {
+        value++;
+    }
+
+    auto [ptr, ec] = std::from_chars(value, end, reading.temperature);
+    if (ec != std::errc() || ptr == value) {
+        return false;
+    }
+
+    reading.timestamp = std::chrono::sys_days(date)
+        + std::chrono::hours(hour) + std::chrono::minutes(minute) + std::chrono::seconds(second)
+        + std::chrono::milliseconds(millisecond);
+    return true;
+}
+
+//! Parses complete lines in [begin, end), malformed lines are counted and skipped.
+std::vector<TReading> ParseTextChunk(const char* begin, const char* end, size_t& malformed) {
+    std::vector<TReading> result;
+    result.reserve((end - begin) / 40);
+
+    while (begin < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        const char* contentEnd = lineEnd;
+        if (contentEnd != begin && contentEnd[-1] == '\r') {
+            contentEnd--;
+        }
+
+        TReading reading;
+        if (TryParseReading(begin, contentEnd, reading)) {
+            result.push_back(reading);
+        } else if (contentEnd != begin) {
+            malformed++;
+        }
+        begin = lineEnd + 1;
+    }
+    return result;
+}
+
+TReadingSeries ReadingsFromTextFile(const std::filesystem::path& file) {
+    TMappedFile mapped(file);
+    const char* data = mapped.GetData();
+    const size_t size = mapped.GetSize();
+
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), size / ParallelChunkSize + 1);
+
+    // Split into newline-aligned chunks, one per thread.
+    std::vector<const char*> bounds = {data};
+    for (size_t i = 1; i < threads; i++) {
+        const char* bound = std::max(bounds.back(), data + size * i / threads);
+        const char* newline = static_cast<const char*>(std::memchr(bound, '\n', data + size - bound));
+        bounds.push_back(newline ? newline + 1 : data + size);
+    }
+    bounds.push_back(data + size);
+
+    std::vector<std::vector<TReading>> chunks(threads);
+    std::vector<size_t> malformed(threads, 0);
+
+    if (threads == 1) {
+        chunks[0] = ParseTextChunk(bounds[0], bounds[1], malformed[0]);
+    } else {
+        NCommon::TInvoker invoker(NCommon::New<NCommon::TThreadPool>(threads));
+        std::vector<std::future<NCommon::TErrorOr<void>>> futures;
+        for (size_t i = 0; i < threads; i++) {
+            futures.push_back(invoker.Run([&, i] {
+                chunks[i] = ParseTextChunk(bounds[i], bounds[i + 1], malformed[i]);
+            }));
+        }
+        for (auto& future : futures) {
+            future.get().ThrowOnError();
+        }
+    }
+
+    TReadingSeries result;
+    size_t skipped = 0;
+    for (size_t i = 0; i < threads; i++) {
+        for (const auto& reading : chunks[i]) {
+            result.push_back(reading);
+        }
+        skipped += malformed[i];
+    }
+
+    if (skipped > 0) {
+        LOG_WARNING("Skipped {} malformed lines in {}", skipped, file);
+    }
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ReadingToString(const TReading& reading) {
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(reading.timestamp);
+    const auto milliseconds = std::chrono::floor<std::chrono::milliseconds>(reading.timestamp - seconds).count();
+    auto time = std::chrono::system_clock::to_time_t(seconds);
+    std::ostringstream oss;
+    oss << std::put_time(gmtime(&time), "%Y-%m-%dT%H:%M:%S");
+
+    // Whole seconds keep the format of older files
+    if (milliseconds != 0) {
+        oss << '.' << std::setfill('0') << std::setw(3) << milliseconds;
+    }
+    oss << "Z " << std::fixed << std::setprecision(std::numeric_limits<double>::digits10 + 1)
+        << reading.temperature;
+    return oss.str();
+}
+
+TReading StringToReading(const std::string& str) {
+    TReading reading;
+    ASSERT(TryParseReading(str.data(), str.data() + str.size(), reading), "Malformed reading '{}'", str);
+    return reading;
+}
+
+NConfig::EFileFormat DetectFileFormat(const std::filesystem::path& file) {
+    std::ifstream fin(file, std::ios::in | std::ios::binary);
+    char magic[sizeof(BinaryMagic)];
+    if (fin.read(magic, sizeof(magic)) && std::memcmp(magic, BinaryMagic, sizeof(magic)) == 0) {
+        return NConfig::EFileFormat::Binary;
+    }
+    return NConfig::EFileFormat::Text;
+}
+
+TReadingSeries ReadingsFromFile(const std::filesystem::path& file) {
+    if (DetectFileFormat(file) == NConfig::EFileFormat::Binary) {
+        try {
+            return ReadingsFromBinaryFile(file);
+        } catch (std::exception& ex) {
+            LOG_WARNING("Failed to read binary file with readings (File: {}, Exception: {})", file, ex);
+            return {};
+        }
+    }
+
+    if (!std::filesystem::exists(file)) {
+        return {};
+    }
+
+    try {
+        return ReadingsFromTextFile(file);
+    } catch (std::exception& ex) {
+        LOG_WARNING("Failed to read file with readings (File: {}, Exception: {})", file, ex);
+        return {};
+    }
+}
+
+void ReadingsToFile(const std::filesystem::path& file, const TReadingSeries& data, const NConfig::TReadingsFormat& format) {
+    try {
+        std::filesystem::create_directory(file.parent_path());
+        std::fstream fout(file, std::ios::out | std::ios::binary);
+        WriteFileHeader(fout, format);
+
+        std::vector<TReading> block;
+        block.reserve(std::min<size_t>(data.size(), 4096));
+        for (const auto& reading : data) {
+            block.push_back(reading);
+            if (block.size() == block.capacity()) {
+                AppendReadings(fout, block, format);
+                block.clear();
+            }
+        }
+        AppendReadings(fout, block, format);
+    } catch (std::exception& ex) {
+        LOG_WARNING("Failed to write readings to file (File: {}, Exception: {})", file, ex);
+    }
+}
+
+void WriteFileHeader(std::ostream& out, const NConfig::TReadingsFormat& format) {
+    if (format.File != NConfig::EFileFormat::Binary) {
+        return;
+    }
+
+    TFileHeader header = {};
+    std::memcpy(header.Magic, BinaryMagic, sizeof(BinaryMagic));
+    header.Version = BinaryVersion;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void AppendReadings(
+    std::ostream& out,
+    std::span<const TReading> readings,
+    const NConfig::TReadingsFormat& format,
+    TTailBlock* tail)
+{
+    if (readings.empty()) {
+        return;
+    }
+
+    if (format.File == NConfig::EFileFormat::Text) {
+        for (const auto& reading : readings) {
+            out << ReadingToString(reading) << '\n';
+        }
+        return;
+    }
+
+    const auto encoding = GetBlockEncoding(readings, format.Value);
+    const bool extend = tail && tail->Offset >= 0 && tail->Encoding == encoding
+        && tail->Count <= std::numeric_limits<uint32_t>::max() - readings.size();
+
+    TBlockHeader header = {
+        .Version = BlockVersion,
+        .Encoding = static_cast<uint16_t>(encoding),
+        .Count = static_cast<uint32_t>(readings.size()) + (extend ? tail->Count : 0),
+    };
+
+    size_t headerSize = extend ? 0 : sizeof(header);
+    size_t recordSize = sizeof(int64_t) + GetValueSize(encoding);
+    std::vector<char> buffer(headerSize + recordSize * readings.size());
+    std::memcpy(buffer.data(), &header, headerSize);
+
+    char* record = buffer.data() + headerSize;
+    for (const auto& reading : readings) {
+        int64_t timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(reading.timestamp.time_since_epoch()).count();
+        std::memcpy(record, &timestampMs, sizeof(timestampMs));
+        EncodeValue(record + sizeof(timestampMs), reading.temperature, encoding);
+        record += recordSize;
+    }
+
+    if (!tail) {
+        out.write(buffer.data(), buffer.size());
+        return;
+    }
+
+    out.seekp(0, std::ios::end);
+    const std::streamoff offset = out.tellp();
+    out.write(buffer.data(), buffer.size());
+
+    if (extend) {
+        // The count is updated after the records, so a torn append leaves
+        // the block as it was
+        out.seekp(tail->Offset + static_cast<std::streamoff>(offsetof(TBlockHeader, Count)));
+        out.write(reinterpret_cast<const char*>(&header.Count), sizeof(header.Count));
+        out.seekp(0, std::ios::end);
+    } else {
+        *tail = {offset, encoding, 0};
+    }
+    tail->Count = header.Count;
+
+    if (!out.good()) {
+        *tail = {};
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
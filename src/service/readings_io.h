@@ -0,0 +1,51 @@
+#pragma once
+
+#include <service/storage.h>
+#include <service/config.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string ReadingToString(const TReading& reading);
+TReading StringToReading(const std::string& str);
+
+//! Detects the format of a readings file by its header, missing and empty
+//! files are reported as text.
+NConfig::EFileFormat DetectFileFormat(const std::filesystem::path& file);
+
+//! Reads readings file of any format, readings are returned in file order (oldest first).
+TReadingSeries ReadingsFromFile(const std::filesystem::path& file);
+
+//! Truncates the file and writes all readings into it.
+void ReadingsToFile(const std::filesystem::path& file, const TReadingSeries& data, const NConfig::TReadingsFormat& format = {});
+
+//! Writes the file header, binary files must start with it.
+void WriteFileHeader(std::ostream& out, const NConfig::TReadingsFormat& format);
+
+//! The last block of a binary file, which later appends continue.
+struct TTailBlock {
+    //! Offset of the block header, negative if there is no block to continue.
+    std::streamoff Offset = -1;
+    NConfig::EValueEncoding Encoding = NConfig::EValueEncoding::Double;
+    uint32_t Count = 0;
+};
+
+//! Appends readings to the end of a file, binary readings are written as a single block.
+//! With `tail` they are added to the block it describes while the encoding matches,
+//! `out` must then be opened without std::ios::app so its count can be updated in place.
+void AppendReadings(
+    std::ostream& out,
+    std::span<const TReading> readings,
+    const NConfig::TReadingsFormat& format,
+    TTailBlock* tail = nullptr);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
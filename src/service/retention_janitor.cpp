@@ -0,0 +1,57 @@
+#include <service/retention_janitor.h>
+
+#include <common/logging.h>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "Janitor";
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TRetentionJanitor::TRetentionJanitor(const std::string& name, std::function<size_t()> pass, std::chrono::milliseconds interval)
+    : Pass_(std::move(pass)),
+      ThreadPool_(NCommon::New<NCommon::TThreadPool>(1)),
+      Invoker_(NCommon::New<NCommon::TInvoker>(ThreadPool_)),
+      Executor_(NCommon::New<NCommon::TPeriodicExecutor>([this] { return RunPass(); }, Invoker_, interval)),
+      PassLatency_(NMetrics::GetMetricRegistry().GetHistogram(name + "_retention_pass_us", NMetrics::ExponentialBounds(1e8))),
+      Removed_(NMetrics::GetMetricRegistry().GetCounter(name + "_retention_removed"))
+{}
+
+TRetentionJanitor::~TRetentionJanitor() {
+    Executor_->Stop();
+
+    // The pool has a single thread, once this task runs the executor is done
+    // with the pass and the pool can be destroyed here
+    Invoker_->Run([] {}).wait();
+}
+
+void TRetentionJanitor::Start() {
+    Executor_->Start();
+}
+
+bool TRetentionJanitor::RunPass() {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        size_t removed = Pass_();
+        Removed_->Increment(removed);
+        if (removed > 0) {
+            LOG_DEBUG("Removed {} expired records", removed);
+        }
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Retention pass failed: {}", ex);
+    }
+    PassLatency_->Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
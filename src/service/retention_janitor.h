@@ -0,0 +1,43 @@
+#pragma once
+
+#include <common/metrics.h>
+#include <common/periodic_executor.h>
+#include <common/threadpool.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Runs retention passes every `interval` on its own thread, so ingestion
+//! never removes expired data itself. A pass returns the number of removed
+//! records, its duration goes to `<name>_retention_pass_us`.
+class TRetentionJanitor {
+public:
+    TRetentionJanitor(const std::string& name, std::function<size_t()> pass, std::chrono::milliseconds interval);
+
+    //! Waits for a pass in progress.
+    ~TRetentionJanitor();
+
+    void Start();
+
+private:
+    bool RunPass();
+
+    std::function<size_t()> Pass_;
+
+    NCommon::TThreadPoolPtr ThreadPool_;
+    NCommon::TInvokerPtr Invoker_;
+    NCommon::TPeriodicExecutorPtr Executor_;
+
+    std::shared_ptr<NMetrics::THistogram> PassLatency_;
+    std::shared_ptr<NMetrics::TCounter> Removed_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,160 @@
+#include <service/ring_file.h>
+
+#include <common/exception.h>
+#include <common/logging.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "RingFile";
+
+constexpr uint64_t RingMagic = 0x474e495250474d54ull; // "TMGPRING"
+constexpr uint32_t RingVersion = 1;
+
+size_t GetFileSize(uint64_t capacity) {
+    return sizeof(TRingFile::THeader) + capacity * sizeof(TRingFile::TRecord);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TRingFile::TRingFile(const std::filesystem::path& path, uint64_t capacity)
+    : Path_(path)
+{
+    ASSERT(capacity > 0, "Ring capacity must be positive");
+
+    if (!Path_.parent_path().empty()) {
+        std::filesystem::create_directories(Path_.parent_path());
+    }
+
+    Fd_ = open(Path_.c_str(), O_RDWR | O_CREAT, 0644);
+    ASSERT(Fd_ != -1, "Failed to open ring file {}: {}", Path_, Errno);
+
+    struct stat st;
+    ASSERT(fstat(Fd_, &st) != -1, "Failed to stat ring file {}: {}", Path_, Errno);
+
+    if (static_cast<size_t>(st.st_size) >= sizeof(THeader)) {
+        THeader header;
+        ASSERT(pread(Fd_, &header, sizeof(header), 0) == sizeof(header), "Failed to read ring header {}: {}", Path_, Errno);
+
+        bool valid = header.Magic == RingMagic
+            && header.Version == RingVersion
+            && header.RecordSize == sizeof(TRecord)
+            && static_cast<size_t>(st.st_size) == GetFileSize(header.Capacity);
+
+        if (valid) {
+            if (header.Capacity != capacity) {
+                LOG_WARNING("Ring file {} has capacity {}, configured capacity {} is ignored", Path_, header.Capacity, capacity);
+            }
+            Map(GetFileSize(header.Capacity));
+            LOG_INFO("Mapped ring file {} with {} readings", Path_, Header_->Count);
+            return;
+        }
+
+        LOG_WARNING("Ring file {} has invalid header, reinitializing it", Path_);
+    }
+
+    ASSERT(ftruncate(Fd_, 0) != -1 && ftruncate(Fd_, GetFileSize(capacity)) != -1,
+        "Failed to allocate ring file {}: {}", Path_, Errno);
+    Map(GetFileSize(capacity));
+    InitHeader(capacity);
+}
+
+TRingFile::~TRingFile() {
+    if (Data_) {
+        munmap(Data_, Size_);
+    }
+    if (Fd_ != -1) {
+        close(Fd_);
+    }
+}
+
+void TRingFile::Map(size_t size) {
+    Data_ = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd_, 0);
+    if (Data_ == MAP_FAILED) {
+        Data_ = nullptr;
+        THROW("Failed to map ring file {}: {}", Path_, Errno);
+    }
+
+    Size_ = size;
+    Header_ = static_cast<THeader*>(Data_);
+    Records_ = reinterpret_cast<TRecord*>(static_cast<char*>(Data_) + sizeof(THeader));
+}
+
+void TRingFile::InitHeader(uint64_t capacity) {
+    Header_->Magic = RingMagic;
+    Header_->Version = RingVersion;
+    Header_->RecordSize = sizeof(TRecord);
+    Header_->Capacity = capacity;
+    Header_->Head = 0;
+    Header_->Tail = 0;
+    Header_->Count = 0;
+}
+
+TReadingSeries TRingFile::ReadAll() const {
+    TReadingSeries result;
+    for (uint64_t i = 0, pos = Header_->Head; i < Header_->Count; i++) {
+        const auto& record = Records_[pos];
+        result.push_back({
+            std::chrono::system_clock::time_point(std::chrono::milliseconds(record.TimestampMs)),
+            record.Temperature
+        });
+        pos = pos + 1 == Header_->Capacity ? 0 : pos + 1;
+    }
+    return result;
+}
+
+void TRingFile::Append(std::span<const TReading> readings) {
+    for (const auto& reading : readings) {
+        Records_[Header_->Tail] = {
+            std::chrono::duration_cast<std::chrono::milliseconds>(reading.timestamp.time_since_epoch()).count(),
+            reading.temperature
+        };
+
+        Header_->Tail = Header_->Tail + 1 == Header_->Capacity ? 0 : Header_->Tail + 1;
+        if (Header_->Count == Header_->Capacity) {
+            Header_->Head = Header_->Tail;
+        } else {
+            Header_->Count++;
+        }
+    }
+}
+
+void TRingFile::Sync() {
+    ASSERT(msync(Data_, Size_, MS_SYNC) != -1, "Failed to sync ring file {}: {}", Path_, Errno);
+}
+
+void TRingFile::DropBefore(std::chrono::system_clock::time_point timestamp) {
+    const int64_t timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+
+    while (Header_->Count > 0 && Records_[Header_->Head].TimestampMs < timestampMs) {
+        Header_->Head = Header_->Head + 1 == Header_->Capacity ? 0 : Header_->Head + 1;
+        Header_->Count--;
+    }
+}
+
+uint64_t TRingFile::GetCount() const {
+    return Header_->Count;
+}
+
+uint64_t TRingFile::GetCapacity() const {
+    return Header_->Capacity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <service/raw_log.h>
+
+#include <cstdint>
+#include <filesystem>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Preallocated memory-mapped circular buffer of raw readings.
+//! File layout is a fixed header followed by `Capacity` packed records.
+//! When the ring is full the oldest record is overwritten.
+class TRingFile
+    : public TRawLogBase
+{
+public:
+    struct THeader {
+        uint64_t Magic;
+        uint32_t Version;
+        uint32_t RecordSize;
+        uint64_t Capacity;
+        uint64_t Head;
+        uint64_t Tail;
+        uint64_t Count;
+    };
+
+    struct TRecord {
+        int64_t TimestampMs;
+        double Temperature;
+    };
+
+    static_assert(sizeof(TRecord) == 16);
+
+    TRingFile(const std::filesystem::path& path, uint64_t capacity);
+    ~TRingFile() override;
+
+    TRingFile(const TRingFile&) = delete;
+    TRingFile& operator=(const TRingFile&) = delete;
+
+    TReadingSeries ReadAll() const override;
+
+    void Append(std::span<const TReading> readings) override;
+
+    //! Writes dirty pages of the mapping, including the header.
+    void Sync() override;
+
+    void DropBefore(std::chrono::system_clock::time_point timestamp) override;
+
+    uint64_t GetCount() const;
+    uint64_t GetCapacity() const;
+
+private:
+    void Map(size_t size);
+    void InitHeader(uint64_t capacity);
+
+    std::filesystem::path Path_;
+    int Fd_ = -1;
+    void* Data_ = nullptr;
+    size_t Size_ = 0;
+
+    THeader* Header_ = nullptr;
+    TRecord* Records_ = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,218 @@
+#include <service/rollup_engine.h>
+
+#include <common/exception.h>
+#include <common/logging.h>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "RollupEngine";
+
+constexpr uint32_t StateVersion = 1;
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromMilliseconds(int64_t timestampMs) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(timestampMs));
+}
+
+nlohmann::json BucketToJson(const TRollupBucket& bucket) {
+    nlohmann::json data;
+    if (bucket.Start) {
+        data["start_ms"] = ToMilliseconds(*bucket.Start);
+    }
+    data["sum"] = bucket.Sum;
+    data["count"] = bucket.Count;
+    if (bucket.Count > 0) {
+        data["min"] = bucket.Min;
+        data["max"] = bucket.Max;
+    }
+    return data;
+}
+
+TRollupBucket BucketFromJson(const nlohmann::json& data) {
+    TRollupBucket bucket;
+    if (data.contains("start_ms")) {
+        bucket.Start = FromMilliseconds(data["start_ms"].get<int64_t>());
+    }
+    bucket.Sum = data.at("sum").get<double>();
+    bucket.Count = data.at("count").get<uint64_t>();
+    if (bucket.Count > 0) {
+        bucket.Min = data.at("min").get<double>();
+        bucket.Max = data.at("max").get<double>();
+    }
+    return bucket;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+void TRollupBucket::Add(double value) {
+    Sum += value;
+    Count++;
+    Min = std::min(Min, value);
+    Max = std::max(Max, value);
+}
+
+double TRollupBucket::GetAverage() const {
+    return Sum / Count;
+}
+
+void TRollupBucket::Reset(std::chrono::system_clock::time_point start) {
+    *this = TRollupBucket();
+    Start = start;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TRollupEngine::TRollupEngine(std::filesystem::path statePath)
+    : StatePath_(std::move(statePath))
+{}
+
+void TRollupEngine::Restore(const TReadingSeries& raw, const TReadingSeries& hourly, const TReadingSeries& daily) {
+    if (LoadState()) {
+        LOG_INFO("Restored rollup state from {} (Hour: {} readings, Day: {} hours)", StatePath_, Hour_.Count, Day_.Count);
+        return;
+    }
+
+    Rebuild(raw, hourly, daily);
+    LOG_INFO("Rebuilt rollup state from series (Hour: {} readings, Day: {} hours)", Hour_.Count, Day_.Count);
+}
+
+bool TRollupEngine::LoadState() {
+    if (!std::filesystem::exists(StatePath_)) {
+        return false;
+    }
+
+    try {
+        std::ifstream fin(StatePath_);
+        auto data = nlohmann::json::parse(fin);
+        ASSERT(data.at("version").get<uint32_t>() == StateVersion, "Unsupported rollup state version");
+
+        Hour_ = BucketFromJson(data.at("hour"));
+        Day_ = BucketFromJson(data.at("day"));
+        LastTimestamp_.reset();
+        if (data.contains("last_timestamp_ms")) {
+            LastTimestamp_ = FromMilliseconds(data["last_timestamp_ms"].get<int64_t>());
+        }
+        return true;
+    } catch (std::exception& ex) {
+        LOG_WARNING("Failed to load rollup state (File: {}, Exception: {})", StatePath_, ex);
+        return false;
+    }
+}
+
+void TRollupEngine::Rebuild(const TReadingSeries& raw, const TReadingSeries& hourly, const TReadingSeries& daily) {
+    Hour_ = TRollupBucket();
+    Day_ = TRollupBucket();
+    LastTimestamp_.reset();
+
+    // The open hour holds raw readings after the last hourly average.
+    if (!hourly.empty()) {
+        Hour_.Start = hourly.back().timestamp;
+    }
+    auto rawBegin = Hour_.Start ? raw.LowerBound(*Hour_.Start + std::chrono::milliseconds(1)) : raw.begin();
+    for (auto iter = rawBegin; iter != raw.end(); ++iter) {
+        if (!Hour_.Start) {
+            Hour_.Start = iter->timestamp;
+        }
+        Hour_.Add(iter->temperature);
+    }
+
+    if (!daily.empty()) {
+        Day_.Start = daily.back().timestamp;
+    }
+    auto hourlyBegin = Day_.Start ? hourly.LowerBound(*Day_.Start + std::chrono::milliseconds(1)) : hourly.begin();
+    for (auto iter = hourlyBegin; iter != hourly.end(); ++iter) {
+        if (!Day_.Start) {
+            Day_.Start = iter->timestamp;
+        }
+        Day_.Add(iter->temperature);
+    }
+
+    if (!raw.empty()) {
+        LastTimestamp_ = raw.back().timestamp;
+    }
+}
+
+TRollupResult TRollupEngine::Add(const TReading& reading) {
+    TRollupResult result;
+    LastTimestamp_ = reading.timestamp;
+
+    if (!Hour_.Start) {
+        Hour_.Start = reading.timestamp;
+    }
+    Hour_.Add(reading.temperature);
+
+    if (reading.timestamp - *Hour_.Start <= std::chrono::hours(1)) {
+        return result;
+    }
+
+    result.Hourly = TReading{reading.timestamp, Hour_.GetAverage()};
+    Hour_.Reset(reading.timestamp);
+
+    if (!Day_.Start) {
+        Day_.Start = reading.timestamp;
+    }
+    Day_.Add(result.Hourly->temperature);
+
+    if (reading.timestamp - *Day_.Start <= std::chrono::days(1)) {
+        return result;
+    }
+
+    result.Daily = TReading{reading.timestamp, Day_.GetAverage()};
+    Day_.Reset(reading.timestamp);
+    return result;
+}
+
+void TRollupEngine::SaveState() const {
+    nlohmann::json data;
+    data["version"] = StateVersion;
+    data["hour"] = BucketToJson(Hour_);
+    data["day"] = BucketToJson(Day_);
+    if (LastTimestamp_) {
+        data["last_timestamp_ms"] = ToMilliseconds(*LastTimestamp_);
+    }
+
+    auto tmpPath = StatePath_;
+    tmpPath += ".tmp";
+    try {
+        {
+            std::ofstream fout(tmpPath, std::ios::out | std::ios::trunc);
+            fout << data.dump();
+            ASSERT(fout.good(), "Failed to write {}", tmpPath);
+        }
+        std::filesystem::rename(tmpPath, StatePath_);
+    } catch (std::exception& ex) {
+        LOG_WARNING("Failed to save rollup state (File: {}, Exception: {})", StatePath_, ex);
+    }
+}
+
+std::optional<std::chrono::system_clock::time_point> TRollupEngine::GetLastTimestamp() const {
+    return LastTimestamp_;
+}
+
+const TRollupBucket& TRollupEngine::GetOpenHour() const {
+    return Hour_;
+}
+
+const TRollupBucket& TRollupEngine::GetOpenDay() const {
+    return Day_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <service/storage.h>
+
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <optional>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Running aggregate of an open bucket.
+struct TRollupBucket {
+    std::optional<std::chrono::system_clock::time_point> Start;
+    double Sum = 0;
+    uint64_t Count = 0;
+    double Min = std::numeric_limits<double>::infinity();
+    double Max = -std::numeric_limits<double>::infinity();
+
+    void Add(double value);
+    double GetAverage() const;
+
+    //! Empties the bucket and opens the next one at `start`.
+    void Reset(std::chrono::system_clock::time_point start);
+};
+
+//! Averages closed by a single reading.
+struct TRollupResult {
+    std::optional<TReading> Hourly;
+    std::optional<TReading> Daily;
+};
+
+//! Incremental hourly and daily averages.
+//! The hour is closed by the first reading more than an hour after its start,
+//! the closing reading is included. The day averages hourly averages and is
+//! checked when an hour closes. Closing a bucket is O(1).
+class TRollupEngine {
+public:
+    explicit TRollupEngine(std::filesystem::path statePath);
+
+    //! Loads accumulators from the state file. Without a usable state file
+    //! they are rebuilt from the persisted series.
+    void Restore(const TReadingSeries& raw, const TReadingSeries& hourly, const TReadingSeries& daily);
+
+    TRollupResult Add(const TReading& reading);
+
+    //! Atomically replaces the state file.
+    void SaveState() const;
+
+    //! Timestamp of the last reading folded into the accumulators,
+    //! newer raw readings must be replayed after Restore.
+    std::optional<std::chrono::system_clock::time_point> GetLastTimestamp() const;
+
+    const TRollupBucket& GetOpenHour() const;
+    const TRollupBucket& GetOpenDay() const;
+
+private:
+    bool LoadState();
+    void Rebuild(const TReadingSeries& raw, const TReadingSeries& hourly, const TReadingSeries& daily);
+
+    std::filesystem::path StatePath_;
+
+    TRollupBucket Hour_;
+    TRollupBucket Day_;
+    std::optional<std::chrono::system_clock::time_point> LastTimestamp_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
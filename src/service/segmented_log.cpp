@@ -0,0 +1,242 @@
+#include <service/segmented_log.h>
+#include <service/readings_io.h>
+
+#include <common/exception.h>
+#include <common/logging.h>
+
+#include <charconv>
+#include <string_view>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "SegmentedLog";
+
+void SyncPath(const std::filesystem::path& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    ASSERT(fd != -1, "Failed to open {} for sync: {}", path, Errno);
+    int result = fdatasync(fd);
+    int error = errno;
+    close(fd);
+    ASSERT(result != -1, "Failed to sync {}: {}", path, NCommon::errno_type{error});
+}
+
+int64_t ToSeconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::floor<std::chrono::seconds>(timestamp.time_since_epoch()).count();
+}
+
+//! Parses a decimal number that spans the whole string.
+bool TryParseNumber(std::string_view str, int64_t& value) {
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+    return ec == std::errc() && ptr == str.data() + str.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSegmentedLog::TSegmentedLog(std::filesystem::path basePath, std::chrono::seconds segmentDuration, NConfig::TReadingsFormat format)
+    : Directory_(basePath.parent_path()),
+      Stem_(basePath.stem().string()),
+      Extension_(basePath.extension().string()),
+      SegmentDuration_(segmentDuration),
+      Format_(format)
+{
+    ASSERT(SegmentDuration_.count() > 0, "Segment duration must be positive");
+
+    if (!Directory_.empty()) {
+        std::filesystem::create_directories(Directory_);
+    }
+    ScanSegments();
+}
+
+void TSegmentedLog::ScanSegments() {
+    const auto& directory = Directory_.empty() ? std::filesystem::path(".") : Directory_;
+    const std::string prefix = Stem_ + ".";
+    std::set<int64_t> legacy;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (!entry.is_regular_file() || entry.path().extension() != Extension_) {
+            continue;
+        }
+
+        auto stem = entry.path().stem().string();
+        if (!stem.starts_with(prefix)) {
+            continue;
+        }
+
+        std::string_view span = std::string_view(stem).substr(prefix.size());
+        auto dot = span.find('.');
+        int64_t start;
+        int64_t duration = SegmentDuration_.count();
+        if (!TryParseNumber(span.substr(0, dot), start)
+            || (dot != std::string_view::npos && !TryParseNumber(span.substr(dot + 1), duration))
+            || duration <= 0)
+        {
+            continue;
+        }
+
+        // Segments named by their start only do not record their duration,
+        // they end where the next segment starts
+        if (dot == std::string_view::npos) {
+            legacy.insert(start);
+        }
+        Segments_.emplace(start, TSegment{entry.path(), start + duration});
+    }
+
+    for (auto segment = Segments_.begin(); segment != Segments_.end(); ++segment) {
+        auto next = std::next(segment);
+        if (next != Segments_.end() && segment->second.End > next->first) {
+            if (!legacy.contains(segment->first)) {
+                LOG_WARNING("Segment {} overlaps {}, its span is cut", segment->second.Path, next->second.Path);
+            }
+            segment->second.End = next->first;
+        }
+    }
+}
+
+TReadingSeries TSegmentedLog::ReadAll() const {
+    TReadingSeries result;
+    for (const auto& [start, segment] : Segments_) {
+        for (const auto& reading : ReadingsFromFile(segment.Path)) {
+            result.push_back(reading);
+        }
+    }
+    return result;
+}
+
+void TSegmentedLog::Append(std::span<const TReading> readings) {
+    while (!readings.empty()) {
+        auto [start, segment] = FindSegment(ToSeconds(readings.front().timestamp));
+        size_t count = 1;
+        while (count < readings.size()) {
+            int64_t seconds = ToSeconds(readings[count].timestamp);
+            if (seconds < start || seconds >= segment.End) {
+                break;
+            }
+            count++;
+        }
+
+        try {
+            if (start != CurrentStart_ || !Current_.is_open()) {
+                OpenSegment(start, segment);
+            }
+
+            AppendReadings(Current_, readings.first(count), Format_, &Tail_);
+            Current_.flush();
+            Unsynced_.insert(start);
+        } catch (std::exception& ex) {
+            LOG_WARNING("Failed to append readings to segment (Segment: {}, Exception: {})", segment.Path, ex);
+        }
+
+        readings = readings.subspan(count);
+    }
+}
+
+void TSegmentedLog::Sync() {
+    for (auto start : Unsynced_) {
+        auto segment = Segments_.find(start);
+        if (segment != Segments_.end()) {
+            SyncPath(segment->second.Path);
+        }
+    }
+    Unsynced_.clear();
+
+    // New segments are durable only once their directory entries are
+    if (std::exchange(DirectoryChanged_, false)) {
+        SyncPath(Directory_.empty() ? std::filesystem::path(".") : Directory_);
+    }
+}
+
+void TSegmentedLog::DropBefore(std::chrono::system_clock::time_point timestamp) {
+    const int64_t seconds = ToSeconds(timestamp);
+
+    while (!Segments_.empty() && Segments_.begin()->second.End <= seconds) {
+        auto [start, segment] = *Segments_.begin();
+        const auto& path = segment.Path;
+        if (start == CurrentStart_) {
+            Current_.close();
+            CurrentStart_.reset();
+        }
+
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        if (ec) {
+            LOG_WARNING("Failed to remove expired segment (Segment: {}, Error: {})", path, ec.message());
+        } else {
+            LOG_DEBUG("Removed expired segment {}", path);
+        }
+        Segments_.erase(Segments_.begin());
+    }
+}
+
+std::pair<int64_t, TSegmentedLog::TSegment> TSegmentedLog::FindSegment(int64_t seconds) const {
+    auto next = Segments_.upper_bound(seconds);
+    auto previous = next == Segments_.begin() ? Segments_.end() : std::prev(next);
+    if (previous != Segments_.end() && seconds < previous->second.End) {
+        return *previous;
+    }
+
+    const int64_t duration = SegmentDuration_.count();
+    int64_t start = seconds / duration * duration;
+    if (seconds < 0 && seconds % duration) {
+        start -= duration;
+    }
+    int64_t end = start + duration;
+
+    // Clipped by segments written with another duration
+    if (previous != Segments_.end()) {
+        start = std::max(start, previous->second.End);
+    }
+    if (next != Segments_.end()) {
+        end = std::min(end, next->first);
+    }
+    return {start, TSegment{GetSegmentPath(start, end - start), end}};
+}
+
+std::filesystem::path TSegmentedLog::GetSegmentPath(int64_t start, int64_t duration) const {
+    return Directory_ / NCommon::Format("{}.{}.{}{}", Stem_, start, duration, Extension_);
+}
+
+void TSegmentedLog::OpenSegment(int64_t start, const TSegment& segment) {
+    Current_.close();
+    Current_.clear();
+
+    const auto& path = segment.Path;
+
+    std::error_code ec;
+    auto size = std::filesystem::file_size(path, ec);
+    bool empty = ec || size == 0;
+    // Rewriting a binary segment also cuts off a block truncated by a crash,
+    // otherwise blocks appended after it would be unreadable.
+    if (!empty && (DetectFileFormat(path) != Format_.File || Format_.File == NConfig::EFileFormat::Binary)) {
+        LOG_INFO("Rewriting segment {} in the configured format", path);
+        ReadingsToFile(path, ReadingsFromFile(path), Format_);
+    }
+
+    // Not in append mode, binary appends update the count of their block
+    Current_.open(path, std::ios::out | std::ios::binary | (empty ? std::ios::trunc : std::ios::in));
+    ASSERT(Current_.is_open(), "Failed to open segment {}", path);
+    Current_.seekp(0, std::ios::end);
+    Tail_ = {};
+
+    if (empty) {
+        WriteFileHeader(Current_, Format_);
+        DirectoryChanged_ = true;
+    }
+
+    CurrentStart_ = start;
+    Segments_.emplace(start, segment);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
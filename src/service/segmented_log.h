@@ -0,0 +1,79 @@
+#pragma once
+
+#include <service/raw_log.h>
+#include <service/readings_io.h>
+#include <service/config.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <set>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Append-only readings log split into fixed time segments.
+//! Segment for 'data/current.log' covering [start, start + duration) is stored
+//! as 'data/current.<start epoch seconds>.<duration seconds>.log', so segments
+//! written with another duration keep their span and new ones start after
+//! them. Retention removes whole segments.
+//! Segments of any format are readable, a non-empty segment reopened for
+//! appending is rewritten in the configured format first.
+class TSegmentedLog
+    : public TRawLogBase
+{
+public:
+    TSegmentedLog(std::filesystem::path basePath, std::chrono::seconds segmentDuration, NConfig::TReadingsFormat format = {});
+
+    //! Reads all segments, readings are returned oldest first.
+    TReadingSeries ReadAll() const override;
+
+    void Append(std::span<const TReading> readings) override;
+
+    //! Syncs segments appended to since the last call and the directory if
+    //! segments were created.
+    void Sync() override;
+
+    //! Unlinks segments that contain only readings older than `timestamp`.
+    void DropBefore(std::chrono::system_clock::time_point timestamp) override;
+
+private:
+    struct TSegment {
+        std::filesystem::path Path;
+        //! Exclusive, in epoch seconds.
+        int64_t End;
+    };
+
+    //! Start and span of the segment for readings of `seconds`: an existing
+    //! one or a new one that does not overlap them.
+    std::pair<int64_t, TSegment> FindSegment(int64_t seconds) const;
+    std::filesystem::path GetSegmentPath(int64_t start, int64_t duration) const;
+
+    void ScanSegments();
+    void OpenSegment(int64_t start, const TSegment& segment);
+
+    std::filesystem::path Directory_;
+    std::string Stem_;
+    std::string Extension_;
+    std::chrono::seconds SegmentDuration_;
+    NConfig::TReadingsFormat Format_;
+
+    //! By start in epoch seconds.
+    std::map<int64_t, TSegment> Segments_;
+
+    std::ofstream Current_;
+    std::optional<int64_t> CurrentStart_;
+
+    //! Binary appends continue the block written by the previous one.
+    TTailBlock Tail_;
+
+    std::set<int64_t> Unsynced_;
+    bool DirectoryChanged_ = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <common/intrusive_ptr.h>
+#include <common/refcounted.h>
+
+#include <iterator>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Immutable-by-sharing sequence built from refcounted fixed-size chunks.
+//! Copying a series is O(1): copies share sealed chunks and the open tail.
+//! Mutations copy only what is shared with other copies: push_back copies the
+//! open tail chunk, sealing a chunk or dropping the first one copies the chunk
+//! spine, which happens once per `ChunkSize` operations.
+//! Mutations of a series are not thread-safe, copies may be read concurrently.
+template <typename T, size_t ChunkSize = 256>
+class TChunkedSeries {
+private:
+    struct TChunk
+        : public NRefCounted::TRefCountedBase
+    {
+        std::vector<T> Items;
+    };
+
+    using TChunkPtr = NCommon::TIntrusivePtr<TChunk>;
+
+    struct TSpine
+        : public NRefCounted::TRefCountedBase
+    {
+        std::vector<TChunkPtr> Chunks;
+    };
+
+    using TSpinePtr = NCommon::TIntrusivePtr<TSpine>;
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using const_reference = const T&;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator() = default;
+
+        const_iterator(const TChunkedSeries* series, size_t index)
+            : Series_(series), Index_(index)
+        {}
+
+        reference operator*() const { return (*Series_)[Index_]; }
+        pointer operator->() const { return &(*Series_)[Index_]; }
+        reference operator[](difference_type n) const { return (*Series_)[Index_ + n]; }
+
+        const_iterator& operator++() { ++Index_; return *this; }
+        const_iterator operator++(int) { auto copy = *this; ++Index_; return copy; }
+        const_iterator& operator--() { --Index_; return *this; }
+        const_iterator operator--(int) { auto copy = *this; --Index_; return copy; }
+
+        const_iterator& operator+=(difference_type n) { Index_ += n; return *this; }
+        const_iterator& operator-=(difference_type n) { Index_ -= n; return *this; }
+
+        friend const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+        friend const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+        friend const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const const_iterator& lhs, const const_iterator& rhs) {
+            return static_cast<difference_type>(lhs.Index_) - static_cast<difference_type>(rhs.Index_);
+        }
+
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) { return lhs.Index_ == rhs.Index_; }
+        friend auto operator<=>(const const_iterator& lhs, const const_iterator& rhs) { return lhs.Index_ <=> rhs.Index_; }
+
+    private:
+        const TChunkedSeries* Series_ = nullptr;
+        size_t Index_ = 0;
+    };
+
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+
+    TChunkedSeries() = default;
+
+    template <typename TIterator>
+    TChunkedSeries(TIterator first, TIterator last) {
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    size_t size() const { return Size_; }
+    bool empty() const { return Size_ == 0; }
+
+    const T& operator[](size_t index) const {
+        size_t position = index + Offset_;
+        size_t chunk = position / ChunkSize;
+        size_t sealed = SealedCount();
+        if (chunk < sealed) {
+            return Sealed_->Chunks[chunk]->Items[position % ChunkSize];
+        }
+        return Tail_->Items[position - sealed * ChunkSize];
+    }
+
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[Size_ - 1]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, Size_); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    void push_back(const T& value) {
+        if (!Tail_) {
+            Tail_ = NCommon::New<TChunk>();
+            Tail_->Items.reserve(ChunkSize);
+        } else if (NRefCounted::GetRefCount(&*Tail_) > 1) {
+            auto tail = NCommon::New<TChunk>();
+            tail->Items.reserve(ChunkSize);
+            tail->Items = Tail_->Items;
+            Tail_ = std::move(tail);
+        }
+
+        Tail_->Items.push_back(value);
+        Size_++;
+
+        if (Tail_->Items.size() == ChunkSize) {
+            MutableSpine().push_back(std::move(Tail_));
+            Tail_.reset();
+        }
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        push_back(T(std::forward<Args>(args)...));
+    }
+
+    void pop_front() {
+        Offset_++;
+        Size_--;
+
+        if (Size_ == 0) {
+            clear();
+        } else if (Offset_ == ChunkSize && SealedCount() > 0) {
+            auto& chunks = MutableSpine();
+            chunks.erase(chunks.begin());
+            Offset_ = 0;
+        }
+    }
+
+    void clear() {
+        Sealed_.reset();
+        Tail_.reset();
+        Offset_ = 0;
+        Size_ = 0;
+    }
+
+private:
+    size_t SealedCount() const {
+        return Sealed_ ? Sealed_->Chunks.size() : 0;
+    }
+
+    std::vector<TChunkPtr>& MutableSpine() {
+        if (!Sealed_) {
+            Sealed_ = NCommon::New<TSpine>();
+        } else if (NRefCounted::GetRefCount(&*Sealed_) > 1) {
+            auto spine = NCommon::New<TSpine>();
+            spine->Chunks = Sealed_->Chunks;
+            Sealed_ = std::move(spine);
+        }
+        return Sealed_->Chunks;
+    }
+
+    TSpinePtr Sealed_;
+    TChunkPtr Tail_;
+
+    //! Number of dropped items at the beginning of the first chunk.
+    size_t Offset_ = 0;
+    size_t Size_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
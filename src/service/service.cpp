@@ -1,17 +1,21 @@
 #include <service/service.h>
 #include <service/file_storage.h>
 #include <service/database_storage.h>
+#include <service/sqlite_storage.h>
+#include <service/async_writer.h>
 
 #include <common/logging.h>
+#include <common/metrics.h>
 #include <common/periodic_executor.h>
 #include <common/weak_ptr.h>
 #include <common/threadpool.h>
 #include <ipc/serial_port.h>
 
+#include <charconv>
 #include <chrono>
-#include <deque>
 #include <iomanip>
 #include <ctime>
+#include <ranges>
 
 
 namespace NService {
@@ -29,19 +33,26 @@ time_t timegm(struct tm* tm) {
 }
 #endif
 
-nlohmann::json CreateReadingsToJson(const std::deque<TReading>& readings, const std::string& period) {
+constexpr size_t DefaultChartPoints = 300;
+
+std::string FormatTimestamp(std::chrono::system_clock::time_point timestamp) {
+    auto time = std::chrono::system_clock::to_time_t(timestamp);
+    std::ostringstream timestampStream;
+    timestampStream << std::put_time(std::gmtime(&time), "%Y-%m-%d %H:%M:%S");
+    return timestampStream.str();
+}
+
+//! Readings are listed newest first.
+nlohmann::json CreateReadingsToJson(const TReadingSeries& readings, const std::string& period) {
     nlohmann::json response;
     response["status"] = "ok";
     response["period"] = period;
     
+    std::vector<TReading> ordered(readings.begin(), readings.end());
     nlohmann::json readingsArray = nlohmann::json::array();
-    for (const auto& reading : readings) {
-        auto time = std::chrono::system_clock::to_time_t(reading.timestamp);
-        std::ostringstream timestampStream;
-        timestampStream << std::put_time(std::gmtime(&time), "%Y-%m-%d %H:%M:%S");
-        
+    for (const auto& reading : std::views::reverse(ordered)) {
         nlohmann::json item;
-        item["timestamp"] = timestampStream.str();
+        item["timestamp"] = FormatTimestamp(reading.timestamp);
         item["temperature"] = reading.temperature;
         readingsArray.push_back(item);
     }
@@ -51,6 +62,65 @@ nlohmann::json CreateReadingsToJson(const std::deque<TReading>& readings, const
     return response;
 }
 
+//! Buckets are listed oldest first, zero resolution means raw readings.
+nlohmann::json CreateAggregatesToJson(const TPyramidSlice& slice) {
+    nlohmann::json response;
+    response["status"] = "ok";
+    response["resolution_ms"] = slice.Resolution.count();
+
+    nlohmann::json bucketsArray = nlohmann::json::array();
+    for (const auto& bucket : slice.Buckets) {
+        nlohmann::json item;
+        item["timestamp"] = FormatTimestamp(bucket.Start);
+        item["min"] = bucket.Min;
+        item["max"] = bucket.Max;
+        item["avg"] = bucket.GetAverage();
+        item["count"] = bucket.Count;
+        bucketsArray.push_back(item);
+    }
+
+    response["buckets"] = bucketsArray;
+    response["count"] = slice.Buckets.size();
+    return response;
+}
+
+template <typename T>
+T ParseUrlArg(const NRpc::TRequest& request, const std::string& key, T defaultValue) {
+    if (!request.HasUrlArg(key)) {
+        return defaultValue;
+    }
+
+    auto value = request.GetUrlArg(key);
+    T result;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || ptr != value.data() + value.size()) {
+        throw NRpc::THttpException(NRpc::EHttpCode::BadRequest, "Invalid '{}' argument: '{}'", key, value);
+    }
+    return result;
+}
+
+//! Time arguments are unix timestamps in milliseconds.
+std::chrono::system_clock::time_point ParseTimeArg(
+    const NRpc::TRequest& request,
+    const std::string& key,
+    std::chrono::system_clock::time_point defaultValue)
+{
+    if (!request.HasUrlArg(key)) {
+        return defaultValue;
+    }
+
+    // The clock counts finer than milliseconds, so not every int64 fits
+    using TTimePoint = std::chrono::system_clock::time_point;
+    const auto minMs = std::chrono::ceil<std::chrono::milliseconds>(TTimePoint::min().time_since_epoch()).count();
+    const auto maxMs = std::chrono::floor<std::chrono::milliseconds>(TTimePoint::max().time_since_epoch()).count();
+
+    auto timestampMs = ParseUrlArg<int64_t>(request, key, 0);
+    if (timestampMs < minMs || timestampMs > maxMs) {
+        throw NRpc::THttpException(NRpc::EHttpCode::BadRequest, "Argument '{}' is out of range: {}", key, timestampMs);
+    }
+    return TTimePoint(std::chrono::milliseconds(timestampMs));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace
@@ -72,9 +142,15 @@ TService::TService(NConfig::TConfigPtr config, std::function<std::optional<TRead
         Storage_ = std::make_unique<TDataBaseStorage>(Config_->StorageConfig->DataBaseConfig);
     } else if (Config_->StorageConfig->FileStorageConfig) {
         Storage_ = std::make_unique<TFileStorage>(Config_->StorageConfig->FileStorageConfig);
+    } else if (Config_->StorageConfig->SqliteStorageConfig) {
+        Storage_ = std::make_unique<TSqliteStorage>(Config_->StorageConfig->SqliteStorageConfig);
     } else {
         THROW("Something went wrong, no storage configured.");
     }
+
+    if (auto writerConfig = Config_->StorageConfig->AsyncWriterConfig) {
+        Storage_ = std::make_unique<TAsyncWriteStorage>(std::move(Storage_), writerConfig);
+    }
 }
 
 TService::~TService() {
@@ -120,52 +196,68 @@ void TService::ProcessTemperature(TReading reading) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-NRpc::TResponse TService::HandleRawReadings(const NRpc::TRequest& request) {
-    auto readingList = Storage_->GetRawReadings();
-    
-    if (IsAcceptType(request, "application/json")) {
-        nlohmann::json jsonResponse = CreateReadingsToJson(readingList, "Raw Data");
-        return NRpc::TResponse()
-            .SetStatus(NRpc::EHttpCode::Ok)
-            .SetJson(jsonResponse)
-            .SetHeader("Access-Control-Allow-Origin", "*")
-            .SetHeader("Access-Control-Allow-Methods", "GET, OPTIONS")
-            .SetHeader("Access-Control-Allow-Headers", "Content-Type, Accept");
+NRpc::TResponse TService::HandleReadings(const NRpc::TRequest& request, EReadingsTier tier, const std::string& period) {
+    if (!IsAcceptType(request, "application/json")) {
+        return NRpc::TResponse().SetStatus(NRpc::EHttpCode::BadRequest);
     }
 
-    return NRpc::TResponse().SetStatus(NRpc::EHttpCode::BadRequest);
+    auto from = ParseTimeArg(request, "from", std::chrono::system_clock::time_point::min());
+    auto to = ParseTimeArg(request, "to", std::chrono::system_clock::time_point::max());
+    auto limit = ParseUrlArg<size_t>(request, "limit", std::numeric_limits<size_t>::max());
+
+    auto readingList = Storage_->GetRange(tier, from, to, limit);
+
+    nlohmann::json jsonResponse = CreateReadingsToJson(readingList, period);
+    return NRpc::TResponse()
+        .SetStatus(NRpc::EHttpCode::Ok)
+        .SetJson(jsonResponse)
+        .SetHeader("Access-Control-Allow-Origin", "*")
+        .SetHeader("Access-Control-Allow-Methods", "GET, OPTIONS")
+        .SetHeader("Access-Control-Allow-Headers", "Content-Type, Accept");
 }
 
-NRpc::TResponse TService::HandleHourlyAverages(const NRpc::TRequest& request) {
-    auto readingList = Storage_->GetHourlyAverage();
-    
-    if (IsAcceptType(request, "application/json")) {
-        nlohmann::json jsonResponse = CreateReadingsToJson(readingList, "Hourly Averages");
-        return NRpc::TResponse()
-            .SetStatus(NRpc::EHttpCode::Ok)
-            .SetJson(jsonResponse)
-            .SetHeader("Access-Control-Allow-Origin", "*")
-            .SetHeader("Access-Control-Allow-Methods", "GET, OPTIONS")
-            .SetHeader("Access-Control-Allow-Headers", "Content-Type, Accept");
+NRpc::TResponse TService::HandleAggregates(const NRpc::TRequest& request) {
+    if (!IsAcceptType(request, "application/json")) {
+        return NRpc::TResponse().SetStatus(NRpc::EHttpCode::BadRequest);
     }
-    
-    return NRpc::TResponse().SetStatus(NRpc::EHttpCode::BadRequest);
+
+    auto from = ParseTimeArg(request, "from", std::chrono::system_clock::time_point::min());
+    auto to = ParseTimeArg(request, "to", std::chrono::system_clock::time_point::max());
+    auto points = ParseUrlArg<size_t>(request, "points", DefaultChartPoints);
+
+    auto slice = Storage_->GetAggregates(from, to, points);
+    if (!slice) {
+        // Short ranges have fewer buckets than requested points, raw readings fit
+        slice = TPyramidSlice{std::chrono::milliseconds::zero(), {}};
+        for (const auto& reading : Storage_->GetRange(EReadingsTier::Raw, from, to)) {
+            slice->Buckets.push_back({reading.timestamp, reading.temperature, reading.temperature, reading.temperature, 1});
+        }
+    }
+
+    return NRpc::TResponse()
+        .SetStatus(NRpc::EHttpCode::Ok)
+        .SetJson(CreateAggregatesToJson(*slice))
+        .SetHeader("Access-Control-Allow-Origin", "*")
+        .SetHeader("Access-Control-Allow-Methods", "GET, OPTIONS")
+        .SetHeader("Access-Control-Allow-Headers", "Content-Type, Accept");
+}
+
+NRpc::TResponse TService::HandleMetrics(const NRpc::TRequest& /*request*/) {
+    return NRpc::TResponse()
+        .SetStatus(NRpc::EHttpCode::Ok)
+        .SetText(NMetrics::GetMetricRegistry().FormatText());
+}
+
+NRpc::TResponse TService::HandleRawReadings(const NRpc::TRequest& request) {
+    return HandleReadings(request, EReadingsTier::Raw, "Raw Data");
+}
+
+NRpc::TResponse TService::HandleHourlyAverages(const NRpc::TRequest& request) {
+    return HandleReadings(request, EReadingsTier::Hourly, "Hourly Averages");
 }
 
 NRpc::TResponse TService::HandleDailyAverages(const NRpc::TRequest& request) {
-    auto readingList = Storage_->GetDailyAverage();
-
-    if (IsAcceptType(request, "application/json")) {
-        nlohmann::json jsonResponse = CreateReadingsToJson(readingList, "Daily Averages");
-        return NRpc::TResponse()
-            .SetStatus(NRpc::EHttpCode::Ok)
-            .SetJson(jsonResponse)
-            .SetHeader("Access-Control-Allow-Origin", "*")
-            .SetHeader("Access-Control-Allow-Methods", "GET, OPTIONS")
-            .SetHeader("Access-Control-Allow-Headers", "Content-Type, Accept");
-    }
-    
-    return NRpc::TResponse().SetStatus(NRpc::EHttpCode::BadRequest);
+    return HandleReadings(request, EReadingsTier::Daily, "Daily Averages");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
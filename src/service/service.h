@@ -33,6 +33,8 @@ private:
 
     void ProcessTemperature(TReading reading);
 
+    NRpc::TResponse HandleReadings(const NRpc::TRequest& request, EReadingsTier tier, const std::string& period);
+
 public:
     TService(NConfig::TConfigPtr config, std::function<std::optional<TReading>(double)> processor);
     ~TService();
@@ -43,6 +45,10 @@ public:
 
     NRpc::TResponse HandleDailyAverages(const NRpc::TRequest& request);
 
+    NRpc::TResponse HandleAggregates(const NRpc::TRequest& request);
+
+    NRpc::TResponse HandleMetrics(const NRpc::TRequest& request);
+
     void Start();
 
 };
@@ -1,4 +1,4 @@
-#include <ui/service_rpc.h>
+#include <service/service_rpc.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -6,6 +6,8 @@ void TRpcServer::Setup(NService::TServicePtr service) {
     RegisterHandler("GET", "/list/raw", NRpc::MakeHandler(&NService::TService::HandleRawReadings, MakeWeak(&*service)));
     RegisterHandler("GET", "/list/hour", NRpc::MakeHandler(&NService::TService::HandleHourlyAverages, MakeWeak(&*service)));
     RegisterHandler("GET", "/list/day", NRpc::MakeHandler(&NService::TService::HandleDailyAverages, MakeWeak(&*service)));
+    RegisterHandler("GET", "/aggregate", NRpc::MakeHandler(&NService::TService::HandleAggregates, MakeWeak(&*service)));
+    RegisterHandler("GET", "/metrics", NRpc::MakeHandler(&NService::TService::HandleMetrics, MakeWeak(&*service)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
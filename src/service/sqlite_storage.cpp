@@ -0,0 +1,382 @@
+#include <service/sqlite_storage.h>
+
+#include <common/logging.h>
+
+#include <limits>
+#include <map>
+
+namespace NService {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline const std::string LoggingSource = "SqliteStorage";
+
+int64_t ToMilliseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+std::string ToPragma(NConfig::ESqliteSynchronous synchronous) {
+    switch (synchronous) {
+        case NConfig::ESqliteSynchronous::Off:
+            return "OFF";
+        case NConfig::ESqliteSynchronous::Normal:
+            return "NORMAL";
+        case NConfig::ESqliteSynchronous::Full:
+            return "FULL";
+    }
+    return "NORMAL";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+TSqliteStorage::TSqliteStorage(NConfig::TSqliteStorageConfigPtr config)
+    : Config_(std::move(config)),
+      Db_(NCommon::New<NIpc::TSqliteDb>(Config_->Path))
+{
+    // WAL lets readers of the file run next to the writer, with `normal`
+    // commits do not wait for fsync
+    Db_->Execute("PRAGMA journal_mode = WAL");
+    Db_->Execute("PRAGMA synchronous = " + ToPragma(Config_->Synchronous));
+    Db_->Execute(NCommon::Format("PRAGMA busy_timeout = {}", Config_->BusyTimeout.count()));
+
+    CreateTables();
+    PrepareStatements();
+    RefreshCache();
+
+    Writer_ = std::make_unique<TBatchWriter>("sqlite_storage", Config_->MaxBatchSize, Config_->MaxBatchLatency,
+        [this] (std::span<const TReading> readings) {
+            auto guard = std::lock_guard(WriteMutex_);
+            IngestBatch(readings);
+        });
+
+    Janitor_ = std::make_unique<TRetentionJanitor>("sqlite_storage", [this] { return RemoveExpired(); }, Config_->RetentionInterval);
+    Janitor_->Start();
+}
+
+TSqliteStorage::~TSqliteStorage() {
+    Janitor_.reset();
+    Writer_.reset();
+
+    if (!Retry_.empty()) {
+        LOG_ERROR("Dropped {} readings that failed to be written", Retry_.size());
+    }
+}
+
+void TSqliteStorage::CreateTables() {
+    // INTEGER PRIMARY KEY makes the timestamp the rowid, rows are stored in
+    // timestamp order and range scans need no separate index
+    Db_->Execute(R"(
+        CREATE TABLE IF NOT EXISTS raw_temperatures (
+            timestamp_ms INTEGER PRIMARY KEY,
+            temperature REAL NOT NULL
+        );
+        CREATE TABLE IF NOT EXISTS hourly_rollups (
+            timestamp_ms INTEGER PRIMARY KEY,
+            sum_temperature REAL NOT NULL,
+            reading_count INTEGER NOT NULL,
+            min_temperature REAL NOT NULL,
+            max_temperature REAL NOT NULL
+        );
+        CREATE TABLE IF NOT EXISTS daily_rollups (
+            timestamp_ms INTEGER PRIMARY KEY,
+            sum_temperature REAL NOT NULL,
+            reading_count INTEGER NOT NULL,
+            min_temperature REAL NOT NULL,
+            max_temperature REAL NOT NULL
+        );
+    )");
+
+    BackfillRollups("hourly_rollups", "hourly_averages", HourMs, HourlyRetentionMs);
+    BackfillRollups("daily_rollups", "daily_averages", DayMs, DailyRetentionMs);
+}
+
+std::string TSqliteStorage::UpsertRollups(const std::string& table, const std::string& source) {
+    return NCommon::Format(
+        "INSERT INTO {} AS r (timestamp_ms, sum_temperature, reading_count, min_temperature, max_temperature) {} "
+        "ON CONFLICT (timestamp_ms) DO UPDATE SET "
+        "   sum_temperature = r.sum_temperature + excluded.sum_temperature, "
+        "   reading_count = r.reading_count + excluded.reading_count, "
+        "   min_temperature = MIN(r.min_temperature, excluded.min_temperature), "
+        "   max_temperature = MAX(r.max_temperature, excluded.max_temperature)",
+        table, source);
+}
+
+void TSqliteStorage::BackfillRollups(
+    const std::string& table,
+    const std::string& legacyTable,
+    int64_t periodMs,
+    int64_t retentionMs)
+{
+    // Same migration as TPostgresReadingsDb::BackfillRollups
+    auto aggregate = [&] (const std::string& source) {
+        return NCommon::Format(
+            "SELECT timestamp_ms / {} * {}, SUM(temperature), COUNT(*), MIN(temperature), MAX(temperature) "
+            "FROM {} WHERE true GROUP BY 1",
+            periodMs, periodMs, source);
+    };
+
+    auto query = [&] (const std::string& text) {
+        auto statement = Db_->Prepare(text);
+        return statement->Step() && statement->GetInt64(0) != 0;
+    };
+
+    NIpc::TSqliteTransaction tx(*Db_);
+    if (query(NCommon::Format("SELECT EXISTS (SELECT 1 FROM {})", table))) {
+        tx.Commit();
+        return;
+    }
+
+    Db_->Execute(UpsertRollups(table, aggregate("raw_temperatures")));
+
+    if (query(NCommon::Format("SELECT EXISTS (SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = '{}')", legacyTable))) {
+        Db_->Execute(UpsertRollups(table, aggregate(NCommon::Format(
+            "(SELECT timestamp_ms, avg_temperature AS temperature FROM {} "
+            "   WHERE timestamp_ms >= (SELECT MAX(timestamp_ms) FROM {}) - {} "
+            "   AND timestamp_ms / {} * {} < (SELECT COALESCE(MIN(timestamp_ms) / {} * {}, {}) FROM raw_temperatures))",
+            legacyTable, legacyTable, retentionMs,
+            periodMs, periodMs, periodMs, periodMs, std::numeric_limits<int64_t>::max()))));
+        LOG_INFO("Copied {} buckets from {} into {}", Db_->GetChanges(), legacyTable, table);
+    }
+    tx.Commit();
+}
+
+void TSqliteStorage::PrepareStatements() {
+    InsertRaw_ = Db_->Prepare("INSERT OR IGNORE INTO raw_temperatures (timestamp_ms, temperature) VALUES (?1, ?2)");
+
+    // Rollups of the readings of one hour, ?1 is the start of the bucket
+    const std::string rollup = "VALUES (?1, ?2, ?3, ?4, ?5)";
+    UpsertHourly_ = Db_->Prepare(UpsertRollups("hourly_rollups", rollup));
+    UpsertDaily_ = Db_->Prepare(UpsertRollups("daily_rollups", rollup));
+
+    // Same batches as the Postgres ones
+    auto deleteBatch = [&] (const std::string& table) {
+        return Db_->Prepare(NCommon::Format(
+            "DELETE FROM {} WHERE timestamp_ms IN ("
+            "   SELECT timestamp_ms FROM {} WHERE timestamp_ms < ?1 ORDER BY timestamp_ms LIMIT ?2"
+            ")", table, table));
+    };
+    DeleteRaw_ = deleteBatch("raw_temperatures");
+    DeleteHourly_ = deleteBatch("hourly_rollups");
+    DeleteDaily_ = deleteBatch("daily_rollups");
+
+    // The newest rollups are open, only the closed ones are averages
+    SelectRaw_ = Db_->Prepare(
+        "SELECT timestamp_ms, temperature FROM raw_temperatures "
+        "WHERE timestamp_ms >= (SELECT MAX(timestamp_ms) FROM raw_temperatures) - ?1 "
+        "ORDER BY timestamp_ms ASC");
+    auto selectClosed = [&] (const std::string& table) {
+        return Db_->Prepare(NCommon::Format(
+            "SELECT timestamp_ms, sum_temperature / reading_count FROM {} "
+            "WHERE timestamp_ms >= (SELECT MAX(timestamp_ms) FROM {}) - ?1 "
+            "AND timestamp_ms < (SELECT MAX(timestamp_ms) FROM {}) "
+            "ORDER BY timestamp_ms ASC", table, table, table));
+    };
+    SelectHourly_ = selectClosed("hourly_rollups");
+    SelectDaily_ = selectClosed("daily_rollups");
+}
+
+void TSqliteStorage::RefreshCache() {
+    TReadingsSnapshot snapshot{NCommon::New<TCache>(), {}, {}};
+
+    snapshot.Cache->rawReadings = LoadSeries(*SelectRaw_, RawRetentionMs);
+    snapshot.Cache->hourlyAverages = LoadSeries(*SelectHourly_, HourlyRetentionMs);
+    snapshot.Cache->dailyAverages = LoadSeries(*SelectDaily_, DailyRetentionMs);
+    snapshot.OpenHour = LoadOpenRollup("hourly_rollups");
+    snapshot.OpenDay = LoadOpenRollup("daily_rollups");
+
+    Cache_.Load(std::move(snapshot));
+}
+
+TRollupBucket TSqliteStorage::LoadOpenRollup(const std::string& table) {
+    auto statement = Db_->Prepare(NCommon::Format(
+        "SELECT timestamp_ms, sum_temperature, reading_count, min_temperature, max_temperature "
+        "FROM {} ORDER BY timestamp_ms DESC LIMIT 1", table));
+
+    TRollupBucket bucket;
+    if (statement->Step()) {
+        bucket.Start = std::chrono::system_clock::time_point(std::chrono::milliseconds(statement->GetInt64(0)));
+        bucket.Sum = statement->GetDouble(1);
+        bucket.Count = static_cast<uint64_t>(statement->GetInt64(2));
+        bucket.Min = statement->GetDouble(3);
+        bucket.Max = statement->GetDouble(4);
+    }
+    return bucket;
+}
+
+TReadingSeries TSqliteStorage::LoadSeries(NIpc::TSqliteStatement& statement, int64_t retentionMs) {
+    TReadingSeries readings;
+    statement.Bind(1, retentionMs);
+    while (statement.Step()) {
+        readings.push_back({
+            std::chrono::system_clock::time_point(std::chrono::milliseconds(statement.GetInt64(0))),
+            statement.GetDouble(1)
+        });
+    }
+    statement.Reset();
+    return readings;
+}
+
+void TSqliteStorage::ProcessTemperature(const TReading& reading) {
+    Writer_->Add(reading);
+}
+
+void TSqliteStorage::IngestBatch(std::span<const TReading> readings) {
+    // Readings of failed batches are older than these, they go first
+    std::span<const TReading> batch = readings;
+    if (!Retry_.empty()) {
+        Retry_.insert(Retry_.end(), readings.begin(), readings.end());
+        batch = Retry_;
+    }
+
+    std::vector<TReading> inserted;
+    try {
+        inserted = WriteBatch(batch);
+    } catch (std::exception& ex) {
+        // The transaction is rolled back, so the cache is still consistent.
+        // A lock held past `busy_timeout_ms` or a full disk is usually gone
+        // by the next batch
+        LOG_ERROR("Failed to process {} readings, retrying with the next batch: {}", batch.size(), ex);
+        InsertRaw_->Reset();
+        UpsertHourly_->Reset();
+        UpsertDaily_->Reset();
+
+        if (Retry_.empty()) {
+            Retry_.assign(readings.begin(), readings.end());
+        }
+        if (Retry_.size() > Config_->RetryBufferSize) {
+            const size_t dropped = Retry_.size() - Config_->RetryBufferSize;
+            LOG_ERROR("Dropped {} oldest readings, the retry buffer is full", dropped);
+            Retry_.erase(Retry_.begin(), Retry_.begin() + dropped);
+        }
+        return;
+    }
+    Retry_.clear();
+
+    for (const auto& reading : inserted) {
+        Cache_.AddToPyramid(reading);
+    }
+
+    if (!Cache_.Append(inserted)) {
+        LOG_INFO("Reloading cache from the database");
+        RefreshCache();
+    }
+}
+
+std::vector<TReading> TSqliteStorage::WriteBatch(std::span<const TReading> readings) {
+    NIpc::TSqliteTransaction tx(*Db_);
+
+    // Usually a single hour, its rollups are updated once per batch
+    std::vector<TReading> inserted;
+    std::map<int64_t, TRollupBucket> hours;
+    for (const auto& reading : readings) {
+        const int64_t tsMs = ToMilliseconds(reading.timestamp);
+        InsertRaw_->Bind(1, tsMs);
+        InsertRaw_->Bind(2, reading.temperature);
+        InsertRaw_->Step();
+        InsertRaw_->Reset();
+
+        // A row that is already there was counted when it was written
+        if (Db_->GetChanges() == 0) {
+            continue;
+        }
+        inserted.push_back(reading);
+        hours[GetBucketStartMs(tsMs, HourMs)].Add(reading.temperature);
+    }
+    for (const auto& [startMs, hour] : hours) {
+        UpsertRollup(*UpsertHourly_, startMs, hour);
+        UpsertRollup(*UpsertDaily_, GetBucketStartMs(startMs, DayMs), hour);
+    }
+
+    tx.Commit();
+    return inserted;
+}
+
+void TSqliteStorage::UpsertRollup(NIpc::TSqliteStatement& statement, int64_t startMs, const TRollupBucket& bucket) {
+    statement.Bind(1, startMs);
+    statement.Bind(2, bucket.Sum);
+    statement.Bind(3, static_cast<int64_t>(bucket.Count));
+    statement.Bind(4, bucket.Min);
+    statement.Bind(5, bucket.Max);
+    statement.Step();
+    statement.Reset();
+}
+
+size_t TSqliteStorage::RemoveExpired() {
+    std::optional<int64_t> newestMs;
+    {
+        auto guard = std::lock_guard(WriteMutex_);
+        newestMs = Cache_.Trim(RawRetentionMs);
+    }
+    if (!newestMs) {
+        return 0;
+    }
+
+    return DeleteInBatches(*DeleteRaw_, *newestMs - RawRetentionMs)
+        + DeleteInBatches(*DeleteHourly_, *newestMs - HourlyRetentionMs)
+        + DeleteInBatches(*DeleteDaily_, *newestMs - DailyRetentionMs);
+}
+
+size_t TSqliteStorage::DeleteInBatches(NIpc::TSqliteStatement& statement, int64_t beforeMs) {
+    const int64_t batchSize = Config_->RetentionBatchSize;
+    size_t removed = 0;
+    while (true) {
+        auto guard = std::lock_guard(WriteMutex_);
+
+        // Each batch commits on its own, so ingestion waits for one batch at most
+        statement.Bind(1, beforeMs);
+        statement.Bind(2, batchSize);
+        try {
+            statement.Step();
+        } catch (...) {
+            statement.Reset();
+            throw;
+        }
+        statement.Reset();
+
+        const int64_t changes = Db_->GetChanges();
+        removed += changes;
+        if (changes < batchSize) {
+            return removed;
+        }
+    }
+}
+
+TReadingSeries TSqliteStorage::GetRawReadings() {
+    return Cache_.Acquire()->rawReadings;
+}
+
+TReadingSeries TSqliteStorage::GetHourlyAverage() {
+    return Cache_.Acquire()->hourlyAverages;
+}
+
+TReadingSeries TSqliteStorage::GetDailyAverage() {
+    return Cache_.Acquire()->dailyAverages;
+}
+
+TReadingSeries TSqliteStorage::GetRange(
+    EReadingsTier tier,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t limit)
+{
+    auto cache = Cache_.Acquire();
+    return SelectRange(GetTier(*cache, tier), from, to, limit);
+}
+
+std::optional<TPyramidSlice> TSqliteStorage::GetAggregates(
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t minPoints)
+{
+    return Cache_.Acquire()->pyramid.Query(from, to, minPoints);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <service/storage.h>
+#include <service/batch_writer.h>
+#include <service/config.h>
+#include <service/readings_cache.h>
+#include <service/retention_janitor.h>
+
+#include <ipc/sqlite_db.h>
+
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace NService {
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Embedded storage in a single SQLite file in WAL mode, for hosts without a
+//! database server. Tables and rollups match TDataBaseStorage: the tables
+//! are keyed by `timestamp_ms`, which SQLite keeps as the rowid index.
+//! Batching, caching and retention are the same as there, a batch is written
+//! in a single transaction.
+class TSqliteStorage
+    : public TTemperatureStorage
+{
+public:
+    TSqliteStorage(NConfig::TSqliteStorageConfigPtr config);
+    ~TSqliteStorage() override;
+
+    TReadingSeries GetRawReadings() override;
+    TReadingSeries GetHourlyAverage() override;
+    TReadingSeries GetDailyAverage() override;
+
+    TReadingSeries GetRange(
+        EReadingsTier tier,
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t limit) override;
+
+    std::optional<TPyramidSlice> GetAggregates(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t minPoints) override;
+
+    void ProcessTemperature(const TReading& reading) override;
+
+private:
+    void CreateTables();
+
+    //! Fills an empty rollup table from the raw rows and from the averages
+    //! of `legacyTable`, which the rollups replace.
+    void BackfillRollups(const std::string& table, const std::string& legacyTable, int64_t periodMs, int64_t retentionMs);
+
+    //! Adds the rows of `source` (bucket start, sum, count, min, max) to the
+    //! rollups in `table`.
+    static std::string UpsertRollups(const std::string& table, const std::string& source);
+
+    void PrepareStatements();
+    void RefreshCache();
+
+    //! Writes readings after the ones of failed batches and updates the
+    //! cache. On failure all of them are kept for the next batch, at most
+    //! `retry_buffer_size` newest ones.
+    void IngestBatch(std::span<const TReading> readings);
+
+    //! Writes readings and their rollups in one transaction, returns the
+    //! readings that were not in the table yet.
+    std::vector<TReading> WriteBatch(std::span<const TReading> readings);
+
+    static void UpsertRollup(NIpc::TSqliteStatement& statement, int64_t startMs, const TRollupBucket& bucket);
+
+    //! Janitor pass: trims the cache and deletes expired rows.
+    size_t RemoveExpired();
+
+    //! Deletes rows older than `beforeMs` with at most `retention_batch_size`
+    //! rows per statement, the writer may go between the statements.
+    size_t DeleteInBatches(NIpc::TSqliteStatement& statement, int64_t beforeMs);
+
+    //! Steps the retained rows of `statement` straight into a series.
+    static TReadingSeries LoadSeries(NIpc::TSqliteStatement& statement, int64_t retentionMs);
+
+    //! The newest row of `table`, empty if there is none.
+    TRollupBucket LoadOpenRollup(const std::string& table);
+
+    const NConfig::TSqliteStorageConfigPtr Config_;
+    NIpc::TSqliteDbPtr Db_;
+
+    std::unique_ptr<NIpc::TSqliteStatement> InsertRaw_;
+    std::unique_ptr<NIpc::TSqliteStatement> UpsertHourly_;
+    std::unique_ptr<NIpc::TSqliteStatement> UpsertDaily_;
+    std::unique_ptr<NIpc::TSqliteStatement> DeleteRaw_;
+    std::unique_ptr<NIpc::TSqliteStatement> DeleteHourly_;
+    std::unique_ptr<NIpc::TSqliteStatement> DeleteDaily_;
+    std::unique_ptr<NIpc::TSqliteStatement> SelectRaw_;
+    std::unique_ptr<NIpc::TSqliteStatement> SelectHourly_;
+    std::unique_ptr<NIpc::TSqliteStatement> SelectDaily_;
+
+    //! Serializes all use of the connection, readers only acquire the cache.
+    std::mutex WriteMutex_;
+    TReadingsCache Cache_;
+
+    //! Readings of failed batches, oldest first.
+    std::vector<TReading> Retry_;
+
+    std::unique_ptr<TBatchWriter> Writer_;
+
+    std::unique_ptr<TRetentionJanitor> Janitor_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace NService
@@ -3,32 +3,85 @@
 #include <common/refcounted.h>
 #include <common/intrusive_ptr.h>
 
-#include <deque>
+#include <service/reading.h>
+#include <service/columnar_series.h>
+#include <service/pyramid.h>
+
+#include <limits>
 
 ////////////////////////////////////////////////////////////////////////////////
 
-struct TReading {
-    std::chrono::system_clock::time_point timestamp;
-    double temperature;
-};
+using TReadingSeries = NService::TColumnarSeries;
 
+//! Series are ordered oldest first, range queries rely on it. Rows expire
+//! relative to the newest raw reading, not to the wall clock.
 struct TCache
     : NRefCounted::TRefCountedBase
 {
-    std::deque<TReading> rawReadings;
-    std::deque<TReading> hourlyAverages;
-    std::deque<TReading> dailyAverages;
+    TReadingSeries rawReadings;
+    TReadingSeries hourlyAverages;
+    TReadingSeries dailyAverages;
+    NService::TPyramid pyramid;
 };
 
 DECLARE_REFCOUNTED(TCache);
 
+enum class EReadingsTier {
+    Raw,
+    Hourly,
+    Daily,
+};
+
+inline const TReadingSeries& GetTier(const TCache& cache, EReadingsTier tier) {
+    switch (tier) {
+        case EReadingsTier::Raw:
+            return cache.rawReadings;
+        case EReadingsTier::Hourly:
+            return cache.hourlyAverages;
+        case EReadingsTier::Daily:
+            return cache.dailyAverages;
+    }
+    return cache.rawReadings;
+}
+
+//! Readings with timestamps in [from, to), at most `limit` newest of them.
+inline TReadingSeries SelectRange(
+    const TReadingSeries& series,
+    std::chrono::system_clock::time_point from,
+    std::chrono::system_clock::time_point to,
+    size_t limit)
+{
+    size_t first = series.IndexOf(series.LowerBound(from));
+    size_t last = series.IndexOf(series.LowerBound(to));
+    if (last <= first) {
+        return {};
+    }
+    return series.Slice(last - first > limit ? last - limit : first, last);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 class TTemperatureStorage {
 public:
-    virtual const std::deque<TReading>& GetRawReadings() = 0;
-    virtual const std::deque<TReading>& GetHourlyAverage() = 0;
-    virtual const std::deque<TReading>& GetDailyAverage() = 0;
+    virtual ~TTemperatureStorage() = default;
+
+    virtual TReadingSeries GetRawReadings() = 0;
+    virtual TReadingSeries GetHourlyAverage() = 0;
+    virtual TReadingSeries GetDailyAverage() = 0;
+
+    //! Readings of the tier with timestamps in [from, to), oldest first.
+    //! When there are more than `limit` of them, only the newest are returned.
+    virtual TReadingSeries GetRange(
+        EReadingsTier tier,
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t limit = std::numeric_limits<size_t>::max()) = 0;
+
+    //! Pre-aggregated buckets for [from, to), see TPyramid::Query.
+    virtual std::optional<NService::TPyramidSlice> GetAggregates(
+        std::chrono::system_clock::time_point from,
+        std::chrono::system_clock::time_point to,
+        size_t minPoints) = 0;
 
     virtual void ProcessTemperature(const TReading& reading) = 0;
 };
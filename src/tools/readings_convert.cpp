@@ -0,0 +1,69 @@
+#include <service/config.h>
+#include <service/readings_io.h>
+
+#include <common/exception.h>
+#include <common/getopts.h>
+#include <common/logging.h>
+
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ConvertFile(const std::filesystem::path& input, const std::filesystem::path& output, const NConfig::TReadingsFormat& format) {
+    auto readings = NService::ReadingsFromFile(input);
+    NService::ReadingsToFile(output, readings, format);
+    LOG_INFO("Converted {} readings: {} -> {}", readings.size(), input, output);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    NCommon::GetOpts opts;
+    opts.AddOption('h', "help", "Show help message");
+    opts.AddOption('i', "input", "Input file or directory with segments", true);
+    opts.AddOption('o', "output", "Output file or directory", true);
+    opts.AddOption('f', "format", "Output format: text or binary (binary by default)", true);
+    opts.AddOption('e', "encoding", "Binary value encoding: double, float or fixed_point (float by default)", true);
+
+    try {
+        opts.Parse(argc, argv);
+
+        if (opts.Has('h')) {
+            std::cerr << "Usage: " << argv[0] << " -i INPUT -o OUTPUT [OPTIONS]\n"
+                      << opts.Help()
+                      << "\nInput format is detected automatically.\n"
+                      << "\nExample:\n  " << argv[0] << " -i data/hourly_avg.log -o data/hourly_avg.bin -e fixed_point\n";
+            return 0;
+        }
+
+        ASSERT(opts.Has('i') && opts.Has('o'), "Input and output must be specified");
+
+        NConfig::TReadingsFormat format;
+        format.File = NConfig::ParseFileFormat(opts.Has('f') ? opts.Get('f') : "binary");
+        if (opts.Has('e')) format.Value = NConfig::ParseValueEncoding(opts.Get('e'));
+
+        std::filesystem::path input = opts.Get('i');
+        std::filesystem::path output = opts.Get('o');
+
+        if (std::filesystem::is_directory(input)) {
+            std::filesystem::create_directories(output);
+            for (const auto& entry : std::filesystem::directory_iterator(input)) {
+                if (entry.is_regular_file()) {
+                    ConvertFile(entry.path(), output / entry.path().filename(), format);
+                }
+            }
+        } else {
+            ConvertFile(input, output, format);
+        }
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Conversion error: {}", ex.what());
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,601 @@
+#include <service/storage.h>
+#include <service/file_storage.h>
+#include <service/database_storage.h>
+#include <service/memory_readings_db.h>
+#include <service/sqlite_storage.h>
+#include <service/series.h>
+#include <service/readings_io.h>
+
+#include <common/atomic_intrusive_ptr.h>
+#include <common/getopts.h>
+#include <common/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <sys/resource.h>
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TBenchOptions {
+    size_t Window = 576000;
+    size_t Iterations = 1000;
+    size_t Lines = 1000000;
+
+    //! Database config for the database benchmarks, they are skipped without it.
+    std::string DbConfigPath;
+};
+
+using TBenchClock = std::chrono::steady_clock;
+
+// Calls of the global operator new, counted by the replacement below main
+std::atomic<size_t> AllocationCount = 0;
+std::atomic<size_t> AllocatedBytes = 0;
+
+//! User and system time of all threads.
+std::chrono::microseconds GetCpuTime() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto toMicroseconds = [] (const timeval& time) {
+        return std::chrono::seconds(time.tv_sec) + std::chrono::microseconds(time.tv_usec);
+    };
+    return toMicroseconds(usage.ru_utime) + toMicroseconds(usage.ru_stime);
+}
+
+TReading MakeReading(size_t index) {
+    return {
+        std::chrono::system_clock::time_point(std::chrono::milliseconds(150 * index)),
+        20.0 + (index % 100) * 0.01
+    };
+}
+
+//! Smooth signal sampled every ~150 ms with jitter, quantized like the fixed_point sensor format.
+TReading MakeSensorReading(size_t index) {
+    int64_t jitterMs = (index * 7919) % 5;
+    double value = 20.0 + 5.0 * std::sin(index * 1e-4) + ((index * 31) % 7) * 0.1;
+    return {
+        std::chrono::system_clock::time_point(std::chrono::milliseconds(1700000000000ll + 150 * index + jitterMs)),
+        std::round(value * 10) / 10
+    };
+}
+
+void Report(const std::string& name, size_t operations, TBenchClock::duration elapsed) {
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    std::cout << std::left << std::setw(32) << name
+              << std::right << std::setw(14) << std::fixed << std::setprecision(1) << ns / operations << " ns/op"
+              << std::setw(12) << operations << " ops\n";
+}
+
+//! Median and tail of per-operation latencies.
+void ReportLatencies(const std::string& name, std::vector<TBenchClock::duration> latencies) {
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&] (double p) {
+        return std::chrono::duration<double, std::micro>(latencies[static_cast<size_t>(p * (latencies.size() - 1))]).count();
+    };
+    std::cout << std::left << std::setw(32) << name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << percentile(0.5) << " us p50"
+              << std::setw(10) << percentile(0.99) << " us p99"
+              << std::setw(12) << latencies.size() << " ops\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename TSeries>
+struct TSeriesCache
+    : NRefCounted::TRefCountedBase
+{
+    TSeries rawReadings;
+};
+
+template <typename TSeries>
+void BenchSnapshotPublish(const std::string& name, const TBenchOptions& options) {
+    NCommon::TAtomicIntrusivePtr<TSeriesCache<TSeries>> cache(NCommon::New<TSeriesCache<TSeries>>());
+    for (size_t i = 0; i < options.Window; i++) {
+        cache.Acquire()->rawReadings.push_back(MakeReading(i));
+    }
+
+    auto start = TBenchClock::now();
+    for (size_t i = 0; i < options.Iterations; i++) {
+        auto current = cache.Acquire();
+        auto next = NCommon::New<TSeriesCache<TSeries>>();
+        next->rawReadings = current->rawReadings;
+        next->rawReadings.push_back(MakeReading(options.Window + i));
+        next->rawReadings.pop_front();
+        cache.Store(next);
+    }
+    Report(name, options.Iterations, TBenchClock::now() - start);
+}
+
+//! Publishing a snapshot per reading: deep deque copy vs structural sharing.
+void BenchSeries(const TBenchOptions& options) {
+    std::cout << "Snapshot publish, window " << options.Window << " readings\n";
+
+    BenchSnapshotPublish<std::deque<TReading>>("deque copy", options);
+    BenchSnapshotPublish<NService::TChunkedSeries<TReading>>("chunked series", options);
+    BenchSnapshotPublish<TReadingSeries>("columnar series", options);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Memory footprint and full-scan throughput: deque vs columnar series.
+void BenchCompression(const TBenchOptions& options) {
+    std::cout << "Compression, window " << options.Window << " readings\n";
+
+    std::deque<TReading> deque;
+    TReadingSeries series;
+    for (size_t i = 0; i < options.Window; i++) {
+        deque.push_back(MakeSensorReading(i));
+        series.push_back(MakeSensorReading(i));
+    }
+
+    // libstdc++ deque allocates 512 byte nodes plus a map of node pointers.
+    constexpr size_t DequeNodeSize = 512;
+    size_t dequeNodes = (deque.size() * sizeof(TReading) + DequeNodeSize - 1) / DequeNodeSize;
+    size_t dequeBytes = dequeNodes * (DequeNodeSize + sizeof(void*)) + sizeof(deque);
+
+    std::cout << std::left << std::setw(32) << "deque" << std::right << std::setw(14) << std::fixed << std::setprecision(2)
+              << double(dequeBytes) / deque.size() << " bytes/reading\n";
+    std::cout << std::left << std::setw(32) << "columnar series" << std::right << std::setw(14) << std::fixed << std::setprecision(2)
+              << double(series.GetMemoryUsage()) / series.size() << " bytes/reading\n";
+
+    double checksum = 0;
+    size_t scans = std::max<size_t>(1, options.Iterations / 100);
+
+    auto start = TBenchClock::now();
+    for (size_t i = 0; i < scans; i++) {
+        for (const auto& reading : deque) {
+            checksum += reading.temperature;
+        }
+    }
+    Report("deque scan", scans * deque.size(), TBenchClock::now() - start);
+
+    start = TBenchClock::now();
+    for (size_t i = 0; i < scans; i++) {
+        for (const auto& reading : series) {
+            checksum += reading.temperature;
+        }
+    }
+    Report("columnar series scan", scans * series.size(), TBenchClock::now() - start);
+
+    std::cout << "checksum " << checksum << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! 24h chart query: full raw range vs pyramid buckets.
+void BenchPyramid(const TBenchOptions& options) {
+    std::cout << "Chart query, window " << options.Window << " readings\n";
+
+    TReadingSeries raw;
+    NService::TPyramid pyramid;
+    for (size_t i = 0; i < options.Window; i++) {
+        auto reading = MakeSensorReading(i);
+        raw.push_back(reading);
+        pyramid.Add(reading);
+    }
+
+    const auto from = raw.back().timestamp - std::chrono::hours(24);
+    const auto to = std::chrono::system_clock::time_point::max();
+    const size_t iterations = std::max<size_t>(1, options.Iterations / 10);
+    double checksum = 0;
+    size_t touched = 0;
+
+    auto start = TBenchClock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        auto range = SelectRange(raw, from, to, std::numeric_limits<size_t>::max());
+        for (const auto& reading : range) {
+            checksum += reading.temperature;
+        }
+        touched = range.size();
+    }
+    Report(NCommon::Format("raw range ({} readings)", touched), iterations, TBenchClock::now() - start);
+
+    start = TBenchClock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        auto slice = pyramid.Query(from, to, 300);
+        for (const auto& bucket : slice->Buckets) {
+            checksum += bucket.GetAverage();
+        }
+        touched = slice->Buckets.size();
+    }
+    Report(NCommon::Format("pyramid ({} buckets)", touched), iterations, TBenchClock::now() - start);
+
+    std::cout << "checksum " << checksum << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Loader used before the mmap-based one: getline + istringstream + get_time.
+size_t LoadWithStreams(const std::filesystem::path& file) {
+    std::deque<TReading> data;
+    std::fstream fin(file, std::ios::in);
+    std::string str;
+    while (std::getline(fin, str)) {
+        std::istringstream iss(str);
+        std::tm tm = {};
+        std::string datetime;
+        double temp;
+        iss >> datetime >> temp;
+
+        std::istringstream dtstream(datetime);
+        dtstream >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
+        data.emplace_back(std::chrono::system_clock::from_time_t(timegm(&tm)), temp);
+    }
+    return data.size();
+}
+
+//! Loading a raw readings file at startup.
+void BenchStartup(const TBenchOptions& options) {
+    std::cout << "Startup load, " << options.Lines << " lines\n";
+
+    auto directory = std::filesystem::temp_directory_path() / "storage_bench";
+    std::filesystem::create_directories(directory);
+    auto textPath = directory / "readings.log";
+    auto binaryPath = directory / "readings.bin";
+
+    TReadingSeries readings;
+    for (size_t i = 0; i < options.Lines; i++) {
+        auto reading = MakeSensorReading(i);
+        reading.timestamp = std::chrono::floor<std::chrono::seconds>(reading.timestamp);
+        readings.push_back(reading);
+    }
+    NService::ReadingsToFile(textPath, readings);
+    NService::ReadingsToFile(binaryPath, readings, {NConfig::EFileFormat::Binary, NConfig::EValueEncoding::Float});
+
+    auto start = TBenchClock::now();
+    size_t loaded = LoadWithStreams(textPath);
+    Report("text, streams", loaded, TBenchClock::now() - start);
+
+    start = TBenchClock::now();
+    loaded = NService::ReadingsFromFile(textPath).size();
+    Report("text, mmap + parallel parse", loaded, TBenchClock::now() - start);
+
+    start = TBenchClock::now();
+    loaded = NService::ReadingsFromFile(binaryPath).size();
+    Report("binary", loaded, TBenchClock::now() - start);
+
+    std::filesystem::remove_all(directory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Ingest latency of TFileStorage under each durability policy. Writes are
+//! done by the flusher thread, `drain` is the time to flush and sync the
+//! backlog when the storage is closed.
+void BenchDurability(const TBenchOptions& options) {
+    std::cout << "File storage ingest, " << options.Iterations << " readings\n";
+
+    struct TPolicy {
+        std::string Name;
+        NConfig::TDurabilityPolicy Policy;
+    };
+    const std::vector<TPolicy> policies = {
+        {"none", {NConfig::EDurability::None}},
+        {"interval 100 ms", {NConfig::EDurability::Interval, std::chrono::milliseconds(100)}},
+        {"records 100", {NConfig::EDurability::Records, {}, 100}},
+        {"records 1", {NConfig::EDurability::Records, {}, 1}},
+    };
+
+    auto directory = std::filesystem::temp_directory_path() / "storage_bench";
+    for (const auto& [name, policy] : policies) {
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+
+        auto config = NCommon::New<NConfig::TFileStorageConfig>();
+        config->TemperaturePath = directory / "current.log";
+        config->TemperatureHourPath = directory / "hourly_avg.log";
+        config->TemperatureDayPath = directory / "daily_avg.log";
+        config->RollupStatePath = directory / "rollup_state.json";
+        config->PyramidStatePath = directory / "pyramid.bin";
+        config->RawLayout = NConfig::ERawLayout::Segments;
+        config->SegmentDuration = std::chrono::minutes(60);
+        config->Durability = policy;
+
+        auto storage = std::make_unique<NService::TFileStorage>(config);
+        auto start = TBenchClock::now();
+        for (size_t i = 0; i < options.Iterations; i++) {
+            storage->ProcessTemperature(MakeSensorReading(i));
+        }
+        Report(NCommon::Format("ingest, {}", name), options.Iterations, TBenchClock::now() - start);
+
+        start = TBenchClock::now();
+        storage.reset();
+        Report(NCommon::Format("drain, {}", name), options.Iterations, TBenchClock::now() - start);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Per-reading ingest latency of TDataBaseStorage next to a bare round trip.
+//! Writes into the service tables and expires old rows, use a scratch database.
+void BenchDbIngest(const TBenchOptions& options) {
+    std::cout << "Database ingest, " << options.Iterations << " readings\n";
+    if (options.DbConfigPath.empty()) {
+        std::cout << "skipped, pass the db_client config with -d\n";
+        return;
+    }
+
+    auto config = NCommon::New<NIpc::TDataBaseConfig>();
+    config->LoadFromFile(options.DbConfigPath);
+    config->MaxBatchSize = 1;
+
+    auto client = NCommon::New<NIpc::TDbClient>(config);
+    client->Connect();
+
+    std::vector<TBenchClock::duration> latencies;
+    for (size_t i = 0; i < options.Iterations; i++) {
+        auto start = TBenchClock::now();
+        client->ExecuteQuery("SELECT 1");
+        latencies.push_back(TBenchClock::now() - start);
+    }
+    ReportLatencies("round trip", latencies);
+
+    NService::TDataBaseStorage storage(config);
+
+    // Newer than anything already stored, the timestamps are primary keys
+    const auto base = std::chrono::floor<std::chrono::milliseconds>(std::chrono::system_clock::now());
+    latencies.clear();
+    for (size_t i = 0; i < options.Iterations; i++) {
+        TReading reading{base + std::chrono::milliseconds(150 * i), MakeSensorReading(i).temperature};
+        auto start = TBenchClock::now();
+        storage.ProcessTemperature(reading);
+        latencies.push_back(TBenchClock::now() - start);
+    }
+    ReportLatencies("ingest", latencies);
+}
+
+//! Cache warm-up of TDataBaseStorage over `Lines` raw readings. Appends the
+//! readings to the service tables, use a scratch database.
+void BenchDbStartup(const TBenchOptions& options) {
+    std::cout << "Database startup, " << options.Lines << " readings\n";
+    if (options.DbConfigPath.empty()) {
+        std::cout << "skipped, pass the db_client config with -d\n";
+        return;
+    }
+
+    auto config = NCommon::New<NIpc::TDataBaseConfig>();
+    config->LoadFromFile(options.DbConfigPath);
+
+    // Creates the tables
+    std::make_unique<NService::TDataBaseStorage>(config).reset();
+
+    auto client = NCommon::New<NIpc::TDbClient>(config);
+    client->Connect();
+
+    // Ends now, so the last day of readings is within retention
+    const int64_t endMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    // Copied in chunks, so generating the rows does not raise the peak itself
+    auto tx = client->BeginTransaction();
+    tx.ExecuteQuery("DELETE FROM raw_temperatures");
+    std::vector<std::tuple<int64_t, double>> rows;
+    for (size_t i = 0; i < options.Lines; i++) {
+        rows.emplace_back(endMs - 150 * static_cast<int64_t>(options.Lines - i), MakeSensorReading(i).temperature);
+        if (rows.size() == 65536 || i + 1 == options.Lines) {
+            tx.CopyRows("raw_temperatures", {"timestamp_ms", "temperature"}, rows);
+            rows.clear();
+        }
+    }
+    tx.Commit();
+
+    auto peakKb = [] {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    };
+
+    const auto peakBefore = peakKb();
+    auto start = TBenchClock::now();
+    NService::TDataBaseStorage storage(config);
+    const size_t loaded = storage.GetRawReadings().size();
+    Report("warm-up", loaded, TBenchClock::now() - start);
+    std::cout << "peak memory growth " << (peakKb() - peakBefore) / 1024 << " MiB\n";
+}
+
+//! Storage-side cost of TDataBaseStorage without a server: `Lines` readings
+//! through ProcessTemperature into the in-memory tables, one by one and in
+//! batches. CPU time and allocations include the flusher and janitor threads.
+void BenchDbMemory(const TBenchOptions& options) {
+    std::cout << "Database storage over in-memory tables, " << options.Lines << " readings\n";
+
+    for (uint32_t batchSize : {1u, 1024u}) {
+        auto config = NCommon::New<NIpc::TDataBaseConfig>();
+        // The connection keys are required but not used
+        config->Load({
+            {"host_address", "127.0.0.1"},
+            {"db_name", "bench"},
+            {"user_name", "bench"},
+            {"password", "bench"},
+            {"max_batch_size", batchSize},
+            {"spool_path", ""},
+        });
+        auto storage = std::make_unique<NService::TDataBaseStorage>(config, std::make_unique<NService::TMemoryReadingsDb>());
+
+        const auto cpuBefore = GetCpuTime();
+        const size_t allocationsBefore = AllocationCount;
+        const size_t bytesBefore = AllocatedBytes;
+        auto start = TBenchClock::now();
+        for (size_t i = 0; i < options.Lines; i++) {
+            storage->ProcessTemperature(MakeSensorReading(i));
+        }
+        // Drains the pending batch
+        storage.reset();
+        const auto elapsed = TBenchClock::now() - start;
+
+        const double readings = options.Lines;
+        Report(NCommon::Format("ingest, batch {}", batchSize), options.Lines, elapsed);
+        std::cout << std::left << std::setw(32) << "  cpu, allocations"
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << std::chrono::duration<double, std::nano>(GetCpuTime() - cpuBefore).count() / readings << " ns/op"
+                  << std::setw(10) << (AllocationCount - allocationsBefore) / readings << " allocs/op"
+                  << std::setw(10) << (AllocatedBytes - bytesBefore) / readings << " B/op\n";
+    }
+}
+
+//! Ingest and range-read throughput of every backend with its defaults, range
+//! reads after a restart. The database backend runs only with -d and writes
+//! into the service tables.
+void BenchBackends(const TBenchOptions& options) {
+    std::cout << "Backends, " << options.Iterations << " readings\n";
+
+    auto directory = std::filesystem::temp_directory_path() / "storage_bench";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::pair<std::string, std::function<std::unique_ptr<TTemperatureStorage>()>>> backends;
+    backends.emplace_back("file", [&] {
+        auto config = NCommon::New<NConfig::TFileStorageConfig>();
+        config->Load({
+            {"temperature", (directory / "current.log").string()},
+            {"hourly", (directory / "hourly_avg.log").string()},
+            {"daily", (directory / "daily_avg.log").string()},
+        });
+        return std::make_unique<NService::TFileStorage>(config);
+    });
+    backends.emplace_back("sqlite", [&] {
+        auto config = NCommon::New<NConfig::TSqliteStorageConfig>();
+        config->Load({{"path", (directory / "temperature.db").string()}});
+        return std::make_unique<NService::TSqliteStorage>(config);
+    });
+    if (!options.DbConfigPath.empty()) {
+        backends.emplace_back("postgres", [&] {
+            auto config = NCommon::New<NIpc::TDataBaseConfig>();
+            config->LoadFromFile(options.DbConfigPath);
+            return std::make_unique<NService::TDataBaseStorage>(config);
+        });
+    }
+
+    // Newer than anything already stored, the timestamps are primary keys
+    const auto base = std::chrono::floor<std::chrono::milliseconds>(std::chrono::system_clock::now());
+    auto reading = [&] (size_t index) {
+        return TReading{base + std::chrono::milliseconds(150 * index), MakeSensorReading(index).temperature};
+    };
+
+    for (const auto& [name, create] : backends) {
+        auto storage = create();
+
+        auto start = TBenchClock::now();
+        for (size_t i = 0; i < options.Iterations; i++) {
+            storage->ProcessTemperature(reading(i));
+        }
+        const auto ingested = TBenchClock::now();
+        Report(NCommon::Format("ingest, {}", name), options.Iterations, ingested - start);
+
+        // The file backend only queues readings for its flusher, the
+        // comparable number is the one with everything written
+        storage.reset();
+        const auto drained = TBenchClock::now();
+        Report(NCommon::Format("drain, {}", name), options.Iterations, drained - ingested);
+        Report(NCommon::Format("ingest + drain, {}", name), options.Iterations, drained - start);
+
+        storage = create();
+
+        // Windows of a tenth of the ingested readings sliding over them
+        const size_t window = std::max<size_t>(options.Iterations / 10, 1);
+        start = TBenchClock::now();
+        for (size_t i = 0; i < options.Iterations; i++) {
+            const size_t first = i % (options.Iterations - window + 1);
+            storage->GetRange(EReadingsTier::Raw, reading(first).timestamp, reading(first + window).timestamp);
+        }
+        Report(NCommon::Format("range read, {}", name), options.Iterations, TBenchClock::now() - start);
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::map<std::string, std::function<void(const TBenchOptions&)>>& GetBenchmarks() {
+    static const std::map<std::string, std::function<void(const TBenchOptions&)>> benchmarks = {
+        {"series", BenchSeries},
+        {"compression", BenchCompression},
+        {"startup", BenchStartup},
+        {"pyramid", BenchPyramid},
+        {"durability", BenchDurability},
+        {"db_ingest", BenchDbIngest},
+        {"db_startup", BenchDbStartup},
+        {"db_memory", BenchDbMemory},
+        {"backends", BenchBackends},
+    };
+    return benchmarks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+void* operator new(size_t size) {
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+    AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept {
+    std::free(ptr);
+}
+
+int main(int argc, const char* argv[]) {
+    NCommon::GetOpts opts;
+    opts.AddOption('h', "help", "Show help message");
+    opts.AddOption('m', "mode", "Benchmark to run (all by default)", true);
+    opts.AddOption('n', "window", "Number of readings in the window", true);
+    opts.AddOption('i', "iterations", "Number of measured operations", true);
+    opts.AddOption('l', "lines", "Number of readings in the startup and in-memory database benchmarks", true);
+    opts.AddOption('d', "db-config", "db_client config for the database benchmarks (use a scratch database)", true);
+
+    try {
+        opts.Parse(argc, argv);
+
+        if (opts.Has('h')) {
+            std::cerr << "Usage: " << argv[0] << " [OPTIONS]\n" << opts.Help() << "\nBenchmarks:\n";
+            for (const auto& [name, bench] : GetBenchmarks()) {
+                std::cerr << "  " << name << "\n";
+            }
+            return 0;
+        }
+
+        TBenchOptions options;
+        if (opts.Has('n')) options.Window = std::stoul(opts.Get('n'));
+        if (opts.Has('i')) options.Iterations = std::stoul(opts.Get('i'));
+        if (opts.Has('l')) options.Lines = std::stoul(opts.Get('l'));
+        if (opts.Has('d')) options.DbConfigPath = opts.Get('d');
+
+        for (const auto& [name, bench] : GetBenchmarks()) {
+            if (!opts.Has('m') || opts.Get('m') == name) {
+                bench(options);
+                std::cout << "\n";
+            }
+        }
+    } catch (const std::exception& ex) {
+        LOG_ERROR("Benchmark error: {}", ex.what());
+        return 2;
+    }
+
+    return 0;
+}